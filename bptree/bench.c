@@ -0,0 +1,404 @@
+#include "bptree.h"
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// YCSB 风格的 B+ 树基准测试:
+//   加载阶段: 按顺序或乱序插入 -n 个键
+//   运行阶段: 按 -r/-i/-s 比例执行查找、插入和范围扫描，键按均匀或 zipfian 分布选取
+// 输出吞吐量、各类操作的 p50/p99/p999 延迟、树高、节点数和内存占用
+
+typedef enum { OP_READ, OP_INSERT, OP_SCAN, OP_TYPES } OpType;
+static const char* op_names[OP_TYPES] = { "read", "insert", "scan" };
+
+typedef enum { FORMAT_TEXT, FORMAT_JSON, FORMAT_CSV } OutputFormat;
+
+typedef struct BenchConfig {
+    int order;
+    long load_keys;
+    long ops;
+    int read_pct;
+    int insert_pct;
+    int scan_pct;
+    int scan_length;
+    bool zipfian;
+    double zipf_theta;
+    bool random_keys;       // 键是否打散 (否则按插入序号递增)
+    int threads;
+    unsigned long seed;
+    OutputFormat format;
+} BenchConfig;
+
+// --- 随机数与键分布 ---
+
+static inline uint64_t xorshift64(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+static inline double random_unit(uint64_t* state) {
+    return (xorshift64(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// 第 i 个插入的键。乱序模式下用 FNV 哈希打散，模拟随机插入
+static inline int key_of(const BenchConfig* config, long i) {
+    if (!config->random_keys) return (int)i;
+    uint64_t h = 14695981039346656037ULL;
+    for (int b = 0; b < 8; b++) {
+        h ^= (uint64_t)(i >> (b * 8)) & 0xff;
+        h *= 1099511628211ULL;
+    }
+    return (int)(h & 0x7fffffff);
+}
+
+// Gray 等人的 zipfian 生成器 (YCSB 同款)，生成 [0, n) 内的排名，0 最热
+typedef struct Zipfian {
+    long n;
+    double theta, alpha, zetan, eta;
+} Zipfian;
+
+static double zeta(long n, double theta) {
+    double sum = 0;
+    for (long i = 1; i <= n; i++) sum += 1.0 / pow((double)i, theta);
+    return sum;
+}
+
+static void init_zipfian(Zipfian* z, long n, double theta) {
+    z->n = n;
+    z->theta = theta;
+    z->alpha = 1.0 / (1.0 - theta);
+    z->zetan = zeta(n, theta);
+    double zeta2 = zeta(2, theta);
+    z->eta = (1.0 - pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta2 / z->zetan);
+}
+
+static long next_zipfian(const Zipfian* z, uint64_t* state) {
+    double u = random_unit(state);
+    double uz = u * z->zetan;
+    if (uz < 1.0) return 0;
+    if (uz < 1.0 + pow(0.5, z->theta)) return 1;
+    long rank = (long)(z->n * pow(z->eta * u - z->eta + 1.0, z->alpha));
+    return rank >= z->n ? z->n - 1 : rank;
+}
+
+// --- 计时与统计 ---
+
+static inline uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+typedef struct LatencyLog {
+    uint64_t* samples;
+    long count;
+} LatencyLog;
+
+typedef struct OpStats {
+    long count;
+    double p50, p99, p999;
+} OpStats;
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const uint64_t* sorted, long n, double p) {
+    if (n == 0) return 0;
+    long idx = (long)(p * (n - 1) + 0.5);
+    return (double)sorted[idx];
+}
+
+// --- 运行阶段 ---
+
+typedef struct Worker {
+    pthread_t thread;
+    const BenchConfig* config;
+    BPTree* tree;
+    const Zipfian* zipf;
+    struct Worker* all;     // 所有线程，计算水位线时读取各自的插入进度
+    int index;              // 线程编号 t: 第 k 次插入的序号是 load_keys + k * threads + t
+    long inserts_done;      // 本线程已完成的插入次数，只由本线程写
+    long watermark;         // 序号小于它的键都已插入完成，读和扫描只从这些键中选取 (定期刷新，旧值只会偏小)
+    long ops;
+    uint64_t rng;
+    LatencyLog logs[OP_TYPES];
+    long scanned;           // 扫描读到的条目数，防止被优化掉
+} Worker;
+
+#define WATERMARK_REFRESH 64    // 每隔多少次操作重新计算一次水位线
+
+// 每个线程都完成了前 k 次插入时，序号小于 load_keys + k * threads 的键都已插入。
+// 插入不需要互相等待，读取各线程的进度只在刷新水位线时进行
+static long insert_watermark(const Worker* w) {
+    long k = LONG_MAX;
+    for (int t = 0; t < w->config->threads; t++) {
+        long done = __atomic_load_n(&w->all[t].inserts_done, __ATOMIC_ACQUIRE);
+        if (done < k) k = done;
+    }
+    return w->config->load_keys + k * w->config->threads;
+}
+
+static void* run_worker(void* arg) {
+    Worker* w = (Worker*)arg;
+    const BenchConfig* config = w->config;
+    int* scan_keys = (int*)malloc(config->scan_length * sizeof(int));
+    void** scan_values = (void**)malloc(config->scan_length * sizeof(void*));
+
+    for (long op = 0; op < w->ops; op++) {
+        int dice = (int)(xorshift64(&w->rng) % 100);
+        OpType type = dice < config->read_pct ? OP_READ
+                    : dice < config->read_pct + config->insert_pct ? OP_INSERT : OP_SCAN;
+
+        // 从已插入的键中选取目标 (还在插入的键不算)
+        if (op % WATERMARK_REFRESH == 0) w->watermark = insert_watermark(w);
+        long existing = w->watermark;
+        long index = config->zipfian ? next_zipfian(w->zipf, &w->rng) % existing
+                                     : (long)(xorshift64(&w->rng) % existing);
+        // 让最热的排名落在最新插入的键上 (YCSB latest 分布的做法)
+        if (config->zipfian) index = existing - 1 - index;
+
+        uint64_t start = now_ns();
+        if (type == OP_READ) {
+            search(w->tree, key_of(config, index));
+        } else if (type == OP_INSERT) {
+            long insert_index = config->load_keys + w->inserts_done * config->threads + w->index;
+            int key = key_of(config, insert_index);
+            insert(w->tree, key, (void*)((long)key + 1));
+        } else {
+            BPTreeCursor cursor;
+            open_cursor(w->tree, &cursor, key_of(config, index), INT_MAX);
+            w->scanned += cursor_next_batch(&cursor, scan_keys, scan_values, config->scan_length);
+        }
+        LatencyLog* log = &w->logs[type];
+        log->samples[log->count++] = now_ns() - start;
+
+        if (type == OP_INSERT) {
+            __atomic_store_n(&w->inserts_done, w->inserts_done + 1, __ATOMIC_RELEASE);
+        }
+    }
+    free(scan_keys);
+    free(scan_values);
+    return NULL;
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -k order        B+ 树的阶 (默认 64)\n"
+        "  -n keys         加载阶段插入的键数 (默认 1000000)\n"
+        "  -o ops          运行阶段的操作数 (默认 1000000)\n"
+        "  -r pct          查找比例 (默认 90)\n"
+        "  -i pct          插入比例 (默认 10)\n"
+        "  -s pct          范围扫描比例 (默认 0)\n"
+        "                  只给出部分比例时，剩余部分归给第一个没给出的 (依次为 -r, -i, -s)\n"
+        "  -l length       每次扫描读取的条目数 (默认 100)\n"
+        "  -d dist         uniform 或 zipfian (默认 uniform)\n"
+        "  -z theta        zipfian 参数，取值 [0, 1) (默认 0.99)\n"
+        "  -m mode         seq 顺序键 或 random 打散的键 (默认 random)\n"
+        "  -t threads      线程数，大于 1 时使用并发模式的树 (默认 1)\n"
+        "  -S seed         随机种子\n"
+        "  -f format       text, json 或 csv (默认 text)\n", prog);
+}
+
+int main(int argc, char** argv) {
+    BenchConfig config = {
+        .order = 64, .load_keys = 1000000, .ops = 1000000,
+        .read_pct = 90, .insert_pct = 10, .scan_pct = 0, .scan_length = 100,
+        .zipfian = false, .zipf_theta = 0.99, .random_keys = true,
+        .threads = 1, .seed = 42, .format = FORMAT_TEXT,
+    };
+    bool read_given = false, insert_given = false, scan_given = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "k:n:o:r:i:s:l:d:z:m:t:S:f:h")) != -1) {
+        switch (opt) {
+            case 'k': config.order = atoi(optarg); break;
+            case 'n': config.load_keys = atol(optarg); break;
+            case 'o': config.ops = atol(optarg); break;
+            case 'r': config.read_pct = atoi(optarg); read_given = true; break;
+            case 'i': config.insert_pct = atoi(optarg); insert_given = true; break;
+            case 's': config.scan_pct = atoi(optarg); scan_given = true; break;
+            case 'l': config.scan_length = atoi(optarg); break;
+            case 'd':
+                if (strcmp(optarg, "zipfian") != 0 && strcmp(optarg, "uniform") != 0) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                config.zipfian = strcmp(optarg, "zipfian") == 0;
+                break;
+            case 'z': config.zipf_theta = atof(optarg); break;
+            case 'm':
+                if (strcmp(optarg, "seq") != 0 && strcmp(optarg, "random") != 0) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                config.random_keys = strcmp(optarg, "random") == 0;
+                break;
+            case 't': config.threads = atoi(optarg); break;
+            case 'S': config.seed = strtoul(optarg, NULL, 10); break;
+            case 'f':
+                if (strcmp(optarg, "json") == 0) config.format = FORMAT_JSON;
+                else if (strcmp(optarg, "csv") == 0) config.format = FORMAT_CSV;
+                else if (strcmp(optarg, "text") == 0) config.format = FORMAT_TEXT;
+                else {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+    // 只给了部分比例时，剩余部分归给第一个没有给出的 (依次为查找、插入、扫描)，其余保持默认值
+    if (!read_given) {
+        config.read_pct = 100 - config.insert_pct - config.scan_pct;
+    } else if (!insert_given) {
+        config.insert_pct = 100 - config.read_pct - config.scan_pct;
+    } else if (!scan_given) {
+        config.scan_pct = 100 - config.read_pct - config.insert_pct;
+    }
+    if (config.read_pct < 0 || config.insert_pct < 0 || config.scan_pct < 0
+        || config.read_pct + config.insert_pct + config.scan_pct != 100) {
+        fprintf(stderr, "操作比例必须非负且合计为 100 (read %d, insert %d, scan %d)\n",
+                config.read_pct, config.insert_pct, config.scan_pct);
+        return 1;
+    }
+    // theta = 1 时生成器的 alpha = 1 / (1 - theta) 除以零
+    if (config.zipf_theta < 0 || config.zipf_theta >= 1) {
+        fprintf(stderr, "zipfian 参数必须在 [0, 1) 内\n");
+        return 1;
+    }
+    if (config.order < 3 || config.load_keys < 1 || config.ops < 0 || config.threads < 1
+        || config.scan_length < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (config.threads > 1 && config.scan_pct > 0 && config.insert_pct > 0) {
+        fprintf(stderr, "范围扫描游标不能与并发插入同时使用，请去掉 -s 或 -i\n");
+        return 1;
+    }
+
+    BPTree* tree = config.threads > 1 ? create_concurrent_bptree(config.order)
+                                      : create_bptree(config.order);
+
+    // 加载阶段
+    uint64_t load_start = now_ns();
+    for (long i = 0; i < config.load_keys; i++) {
+        int key = key_of(&config, i);
+        insert(tree, key, (void*)((long)key + 1));
+    }
+    double load_seconds = (now_ns() - load_start) / 1e9;
+
+    // 运行阶段
+    Zipfian zipf;
+    if (config.zipfian) init_zipfian(&zipf, config.load_keys, config.zipf_theta);
+    Worker* workers = (Worker*)calloc(config.threads, sizeof(Worker));
+    for (int t = 0; t < config.threads; t++) {
+        Worker* w = &workers[t];
+        w->config = &config;
+        w->tree = tree;
+        w->zipf = &zipf;
+        w->all = workers;
+        w->index = t;
+        w->watermark = config.load_keys;
+        w->ops = config.ops / config.threads + (t < config.ops % config.threads ? 1 : 0);
+        w->rng = config.seed * 0x9E3779B97F4A7C15ULL + t + 1;
+        for (int type = 0; type < OP_TYPES; type++) {
+            w->logs[type].samples = (uint64_t*)malloc((w->ops + 1) * sizeof(uint64_t));
+        }
+    }
+    uint64_t run_start = now_ns();
+    for (int t = 0; t < config.threads; t++) {
+        pthread_create(&workers[t].thread, NULL, run_worker, &workers[t]);
+    }
+    for (int t = 0; t < config.threads; t++) {
+        pthread_join(workers[t].thread, NULL);
+    }
+    double run_seconds = (now_ns() - run_start) / 1e9;
+
+    // 汇总各线程的延迟样本
+    OpStats stats[OP_TYPES];
+    for (int type = 0; type < OP_TYPES; type++) {
+        long total = 0;
+        for (int t = 0; t < config.threads; t++) total += workers[t].logs[type].count;
+        uint64_t* all = (uint64_t*)malloc((total + 1) * sizeof(uint64_t));
+        long pos = 0;
+        for (int t = 0; t < config.threads; t++) {
+            memcpy(all + pos, workers[t].logs[type].samples, workers[t].logs[type].count * sizeof(uint64_t));
+            pos += workers[t].logs[type].count;
+        }
+        qsort(all, total, sizeof(uint64_t), compare_u64);
+        stats[type].count = total;
+        stats[type].p50 = percentile(all, total, 0.50);
+        stats[type].p99 = percentile(all, total, 0.99);
+        stats[type].p999 = percentile(all, total, 0.999);
+        free(all);
+    }
+
+    BPTreeMemStats mem;
+    get_memory_stats(tree, &mem);
+    int height = get_tree_height(tree);
+    double load_tput = config.load_keys / load_seconds;
+    double run_tput = run_seconds > 0 ? config.ops / run_seconds : 0;
+    const char* dist = config.zipfian ? "zipfian" : "uniform";
+    const char* mode = config.random_keys ? "random" : "seq";
+
+    if (config.format == FORMAT_JSON) {
+        printf("{\"order\":%d,\"load_keys\":%ld,\"ops\":%ld,\"threads\":%d,"
+               "\"read_pct\":%d,\"insert_pct\":%d,\"scan_pct\":%d,\"scan_length\":%d,"
+               "\"distribution\":\"%s\",\"key_mode\":\"%s\","
+               "\"load_seconds\":%.6f,\"load_ops_per_sec\":%.1f,"
+               "\"run_seconds\":%.6f,\"run_ops_per_sec\":%.1f,\"latency_ns\":{",
+               config.order, config.load_keys, config.ops, config.threads,
+               config.read_pct, config.insert_pct, config.scan_pct, config.scan_length,
+               dist, mode, load_seconds, load_tput, run_seconds, run_tput);
+        for (int type = 0; type < OP_TYPES; type++) {
+            printf("%s\"%s\":{\"count\":%ld,\"p50\":%.0f,\"p99\":%.0f,\"p999\":%.0f}",
+                   type ? "," : "", op_names[type], stats[type].count,
+                   stats[type].p50, stats[type].p99, stats[type].p999);
+        }
+        printf("},\"height\":%d,\"nodes\":%zu,\"bytes_in_use\":%zu,\"bytes_reserved\":%zu}\n",
+               height, mem.node_count, mem.bytes_in_use, mem.bytes_reserved);
+    } else if (config.format == FORMAT_CSV) {
+        printf("order,load_keys,ops,threads,read_pct,insert_pct,scan_pct,scan_length,distribution,key_mode,"
+               "load_seconds,load_ops_per_sec,run_seconds,run_ops_per_sec");
+        for (int type = 0; type < OP_TYPES; type++) {
+            printf(",%s_count,%s_p50_ns,%s_p99_ns,%s_p999_ns",
+                   op_names[type], op_names[type], op_names[type], op_names[type]);
+        }
+        printf(",height,nodes,bytes_in_use,bytes_reserved\n");
+        printf("%d,%ld,%ld,%d,%d,%d,%d,%d,%s,%s,%.6f,%.1f,%.6f,%.1f",
+               config.order, config.load_keys, config.ops, config.threads,
+               config.read_pct, config.insert_pct, config.scan_pct, config.scan_length,
+               dist, mode, load_seconds, load_tput, run_seconds, run_tput);
+        for (int type = 0; type < OP_TYPES; type++) {
+            printf(",%ld,%.0f,%.0f,%.0f", stats[type].count, stats[type].p50, stats[type].p99, stats[type].p999);
+        }
+        printf(",%d,%zu,%zu,%zu\n", height, mem.node_count, mem.bytes_in_use, mem.bytes_reserved);
+    } else {
+        printf("---- B+Tree Benchmark ----\n");
+        printf("order %d, %d thread(s), %s keys, %s distribution\n", config.order, config.threads, mode, dist);
+        printf("load:  %ld keys in %.3fs (%.0f ops/s)\n", config.load_keys, load_seconds, load_tput);
+        printf("run:   %ld ops in %.3fs (%.0f ops/s), mix read %d%% / insert %d%% / scan %d%%\n",
+               config.ops, run_seconds, run_tput, config.read_pct, config.insert_pct, config.scan_pct);
+        for (int type = 0; type < OP_TYPES; type++) {
+            if (stats[type].count == 0) continue;
+            printf("  %-6s count %-9ld p50 %6.0fns  p99 %7.0fns  p999 %8.0fns\n", op_names[type],
+                   stats[type].count, stats[type].p50, stats[type].p99, stats[type].p999);
+        }
+        printf("tree:  height %d, %zu nodes, %zu bytes in use, %zu bytes reserved\n",
+               height, mem.node_count, mem.bytes_in_use, mem.bytes_reserved);
+    }
+
+    for (int t = 0; t < config.threads; t++) {
+        for (int type = 0; type < OP_TYPES; type++) free(workers[t].logs[type].samples);
+    }
+    free(workers);
+    destroy_tree(tree);
+    return 0;
+}
@@ -1,7 +1,8 @@
 #include "bptree.h"
+#include <sched.h>
 
 // --- 内部辅助函数声明 ---
-Node* create_node(int order, bool is_leaf);
+Node* create_node(BPTree* tree, bool is_leaf);
 Node* find_leaf(Node* root, int key);
 void insert_into_leaf(Node* leaf, int key, void* value);
 void insert_into_parent(BPTree* tree, Node* left, int key, Node* right);
@@ -9,52 +10,330 @@ void split_leaf_and_insert(BPTree* tree, Node* leaf, int key, void* value);
 void insert_into_internal(Node* parent, int left_index, int key, Node* right);
 void split_internal_and_insert(BPTree* tree, Node* old_node, int left_index, int key, Node* right);
 void insert_into_new_root(BPTree* tree, Node* left, int key, Node* right);
+void insert_concurrent(BPTree* tree, int key, void* value);
+void* search_concurrent(BPTree* tree, int key);
+bool remove_concurrent(BPTree* tree, int key);
+void free_node(BPTree* tree, Node* node);
+void rebalance_after_remove(BPTree* tree, Node* node);
+
+#define CACHE_LINE_SIZE 64
+#define ALIGN_UP(n, a) (((n) + (a) - 1) / (a) * (a))
+
+// --- 节点内键查找 ---
+// 节点内的键有序，因此 "小于 key 的键的个数" 就是 key 的插入位置，
+// "小于等于 key 的键的个数" 就是内部节点中应走的子指针下标。
+// 用向量比较一次统计多个键，没有依赖比较结果的分支。
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+static inline int count_keys_less(const int* keys, int n, int key) {
+    __m256i k = _mm256_set1_epi32(key);
+    int i = 0, count = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(keys + i));
+        __m256i lt = _mm256_cmpgt_epi32(k, v);
+        count += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(lt)));
+    }
+    for (; i < n; i++) count += keys[i] < key;
+    return count;
+}
+
+static inline int count_keys_less_equal(const int* keys, int n, int key) {
+    __m256i k = _mm256_set1_epi32(key);
+    int i = 0, count = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(keys + i));
+        __m256i gt = _mm256_cmpgt_epi32(v, k);
+        count += 8 - __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(gt)));
+    }
+    for (; i < n; i++) count += keys[i] <= key;
+    return count;
+}
+
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+
+static inline int count_keys_less(const int* keys, int n, int key) {
+    __m128i k = _mm_set1_epi32(key);
+    int i = 0, count = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(keys + i));
+        __m128i lt = _mm_cmpgt_epi32(k, v);
+        count += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(lt)));
+    }
+    for (; i < n; i++) count += keys[i] < key;
+    return count;
+}
+
+static inline int count_keys_less_equal(const int* keys, int n, int key) {
+    __m128i k = _mm_set1_epi32(key);
+    int i = 0, count = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(keys + i));
+        __m128i gt = _mm_cmpgt_epi32(v, k);
+        count += 4 - __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(gt)));
+    }
+    for (; i < n; i++) count += keys[i] <= key;
+    return count;
+}
+
+#else
+
+static inline int count_keys_less(const int* keys, int n, int key) {
+    int count = 0;
+    for (int i = 0; i < n; i++) count += keys[i] < key;
+    return count;
+}
+
+static inline int count_keys_less_equal(const int* keys, int n, int key) {
+    int count = 0;
+    for (int i = 0; i < n; i++) count += keys[i] <= key;
+    return count;
+}
+
+#endif
 
 // --- 创建与销毁 ---
 
+// 节点头、键数组和指针数组放在同一块按缓存行对齐的内存中:
+// [Node 头 (补齐到缓存行)][keys: order - 1 个 int][pointers: order 个指针]
+// 键数组从缓存行边界开始，便于 SIMD 顺序加载
+#define NODE_KEYS_OFFSET ALIGN_UP(sizeof(Node), CACHE_LINE_SIZE)
+#define NODE_POINTERS_OFFSET(order) ALIGN_UP(NODE_KEYS_OFFSET + ((order) - 1) * sizeof(int), sizeof(void*))
+#define NODE_BLOCK_SIZE(order) ALIGN_UP(NODE_POINTERS_OFFSET(order) + (order) * sizeof(void*), CACHE_LINE_SIZE)
+
+#define NODE_CHUNK_BYTES (256 * 1024)   // 每个 chunk 的目标大小
+#define MIN_NODES_PER_CHUNK 8
+
 BPTree* create_bptree(int order) {
     BPTree* tree = (BPTree*)malloc(sizeof(BPTree));
     tree->order = order;
-    tree->root = create_node(order, true);
+
+    NodeArena* arena = &tree->arena;
+    arena->node_size = NODE_BLOCK_SIZE(order);
+    arena->nodes_per_chunk = NODE_CHUNK_BYTES / arena->node_size;
+    if (arena->nodes_per_chunk < MIN_NODES_PER_CHUNK) {
+        arena->nodes_per_chunk = MIN_NODES_PER_CHUNK;
+    }
+    arena->chunks = NULL;
+    arena->bump = NULL;
+    arena->bump_end = NULL;
+    arena->free_list = NULL;
+    arena->chunk_count = 0;
+    arena->nodes_in_use = 0;
+    pthread_mutex_init(&arena->lock, NULL);
+    tree->concurrent = false;
+    tree->lazy_delete = false;
+
+    tree->scratch_keys = (int*)malloc((order + 1) * sizeof(int));
+    tree->scratch_pointers = (void**)malloc((order + 1) * sizeof(void*));
+    tree->root = create_node(tree, true);
     return tree;
 }
 
-Node* create_node(int order, bool is_leaf) {
-    Node* node = (Node*)malloc(sizeof(Node));
+// 从内存池中取一个节点块: 优先复用空闲链表，否则从当前 chunk 切分，chunk 用完再申请新的
+static void* arena_alloc(NodeArena* arena) {
+    arena->nodes_in_use++;
+    if (arena->free_list != NULL) {
+        void* block = arena->free_list;
+        arena->free_list = *(void**)block;
+        return block;
+    }
+    if (arena->bump == arena->bump_end) {
+        size_t header = ALIGN_UP(sizeof(NodeChunk), CACHE_LINE_SIZE);
+        size_t size = header + (size_t)arena->nodes_per_chunk * arena->node_size;
+        NodeChunk* chunk = (NodeChunk*)aligned_alloc(CACHE_LINE_SIZE, size);
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+        arena->chunk_count++;
+        arena->bump = (char*)chunk + header;
+        arena->bump_end = (char*)chunk + size;
+    }
+    void* block = arena->bump;
+    arena->bump += arena->node_size;
+    return block;
+}
+
+BPTree* create_concurrent_bptree(int order) {
+    BPTree* tree = create_bptree(order);
+    tree->concurrent = true;
+    return tree;
+}
+
+Node* create_node(BPTree* tree, bool is_leaf) {
+    if (tree->concurrent) pthread_mutex_lock(&tree->arena.lock);
+    char* block = (char*)arena_alloc(&tree->arena);
+    if (tree->concurrent) pthread_mutex_unlock(&tree->arena.lock);
+
+    Node* node = (Node*)block;
+    node->version = 0;
     node->is_leaf = is_leaf;
     node->num_keys = 0;
-    node->keys = (int*)malloc((order - 1) * sizeof(int));
-    node->pointers = (void**)malloc(order * sizeof(void*));
+    node->keys = (int*)(block + NODE_KEYS_OFFSET);
+    node->pointers = (void**)(block + NODE_POINTERS_OFFSET(tree->order));
     node->parent = NULL;
     node->next = NULL;
     return node;
 }
 
-void destroy_node(Node* node) {
-    if (node == NULL) return;
-    if (!node->is_leaf) {
-        for (int i = 0; i < node->num_keys + 1; i++) {
-            destroy_node((Node*)node->pointers[i]);
-        }
-    }
-    free(node->keys);
-    free(node->pointers);
-    free(node);
+// 把节点块放回内存池的空闲链表，供之后的 create_node 复用
+void free_node(BPTree* tree, Node* node) {
+    NodeArena* arena = &tree->arena;
+    *(void**)node = arena->free_list;
+    arena->free_list = node;
+    arena->nodes_in_use--;
 }
 
+// 销毁整棵树: 所有节点都在内存池的 chunk 中，逐个 chunk 释放即可
 void destroy_tree(BPTree* tree) {
-    destroy_node(tree->root);
+    NodeChunk* chunk = tree->arena.chunks;
+    while (chunk != NULL) {
+        NodeChunk* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    pthread_mutex_destroy(&tree->arena.lock);
+    free(tree->scratch_keys);
+    free(tree->scratch_pointers);
     free(tree);
 }
 
+void get_memory_stats(BPTree* tree, BPTreeMemStats* stats) {
+    NodeArena* arena = &tree->arena;
+    size_t chunk_bytes = ALIGN_UP(sizeof(NodeChunk), CACHE_LINE_SIZE)
+                         + (size_t)arena->nodes_per_chunk * arena->node_size;
+    stats->chunk_count = arena->chunk_count;
+    stats->node_count = arena->nodes_in_use;
+    stats->bytes_in_use = arena->nodes_in_use * arena->node_size;
+    stats->bytes_reserved = arena->chunk_count * chunk_bytes
+                            + (tree->order + 1) * (sizeof(int) + sizeof(void*));
+}
+
+int get_tree_height(BPTree* tree) {
+    int height = 1;
+    for (Node* node = tree->root; !node->is_leaf; height++) {
+        node = (Node*)node->pointers[0];
+    }
+    return height;
+}
+
+// --- 批量构建 ---
+
+// 把 count 个条目分配到若干节点中: 节点数按填充率计算，条目均匀分布，
+// 保证每个节点不超过 capacity，并且 (多于一个节点时) 不少于 min_entries
+static int plan_node_count(int count, int capacity, int min_entries, double fill_factor) {
+    int target = (int)(capacity * fill_factor);
+    if (target < min_entries) target = min_entries;
+    if (target > capacity) target = capacity;
+
+    int nodes = (count + target - 1) / target;
+    if (nodes > 1 && count / nodes < min_entries) {
+        nodes = (count + capacity - 1) / capacity;
+    }
+    return nodes < 1 ? 1 : nodes;
+}
+
+BPTree* bulk_load_bptree_stream(int order, int n, kv_source_fn next, void* ctx, double fill_factor) {
+    if (order < 3 || n < 0) return NULL;
+    if (fill_factor <= 0 || fill_factor > 1) fill_factor = 1.0;
+
+    BPTree* tree = create_bptree(order);
+    if (n == 0) return tree;
+
+    // 1. 构建叶子层，顺便检查输入是否严格递增
+    int count = plan_node_count(n, order - 1, order / 2, fill_factor);
+    Node** level = (Node**)malloc(count * sizeof(Node*));
+    int* level_min = (int*)malloc(count * sizeof(int));
+    int base = n / count, extra = n % count;
+    bool sorted = true;
+    int prev_key = 0;
+
+    level[0] = tree->root;
+    for (int i = 0; i < count && sorted; i++) {
+        Node* leaf = (i == 0) ? tree->root : create_node(tree, true);
+        level[i] = leaf;
+        if (i > 0) level[i - 1]->next = leaf;
+
+        int entries = base + (i < extra ? 1 : 0);
+        for (int j = 0; j < entries; j++) {
+            int key;
+            void* value;
+            if (!next(ctx, &key, &value) || (i + j > 0 && key <= prev_key)) {
+                sorted = false;
+                break;
+            }
+            leaf->keys[j] = key;
+            leaf->pointers[j] = value;
+            leaf->num_keys++;
+            prev_key = key;
+        }
+        if (!sorted) break;
+        level_min[i] = leaf->keys[0];
+    }
+    if (!sorted) {
+        // 已经生成的节点都在树的内存池中，随树一起释放
+        free(level);
+        free(level_min);
+        destroy_tree(tree);
+        return NULL;
+    }
+
+    // 2. 逐层向上构建内部节点，分隔键取右侧子树的最小键
+    while (count > 1) {
+        int parents = plan_node_count(count, order, (order + 1) / 2, fill_factor);
+        base = count / parents;
+        extra = count % parents;
+        int child = 0;
+        for (int i = 0; i < parents; i++) {
+            Node* parent = create_node(tree, false);
+            int children = base + (i < extra ? 1 : 0);
+            for (int j = 0; j < children; j++, child++) {
+                if (j > 0) parent->keys[j - 1] = level_min[child];
+                parent->pointers[j] = level[child];
+                level[child]->parent = parent;
+            }
+            parent->num_keys = children - 1;
+            level_min[i] = level_min[child - children];
+            level[i] = parent;
+        }
+        count = parents;
+    }
+
+    tree->root = level[0];
+    free(level);
+    free(level_min);
+    return tree;
+}
+
+typedef struct ArraySource {
+    const int* keys;
+    void* const* values;
+    int pos;
+} ArraySource;
+
+static bool next_from_array(void* ctx, int* key, void** value) {
+    ArraySource* src = (ArraySource*)ctx;
+    *key = src->keys[src->pos];
+    *value = src->values ? src->values[src->pos] : NULL;
+    src->pos++;
+    return true;
+}
+
+BPTree* bulk_load_bptree(int order, const int* keys, void* const* values, int n, double fill_factor) {
+    ArraySource src = { keys, values, 0 };
+    return bulk_load_bptree_stream(order, n, next_from_array, &src, fill_factor);
+}
+
+
 // --- 查找操作 ---
 
 void* search(BPTree* tree, int key) {
+    if (tree->concurrent) return search_concurrent(tree, key);
     Node* leaf = find_leaf(tree->root, key);
-    for (int i = 0; i < leaf->num_keys; i++) {
-        if (leaf->keys[i] == key) {
-            return leaf->pointers[i];
-        }
+    int i = count_keys_less(leaf->keys, leaf->num_keys, key);
+    if (i < leaf->num_keys && leaf->keys[i] == key) {
+        return leaf->pointers[i];
     }
     return NULL;
 }
@@ -62,20 +341,213 @@ void* search(BPTree* tree, int key) {
 Node* find_leaf(Node* root, int key) {
     Node* current = root;
     while (!current->is_leaf) {
-        int i = 0;
-        // 找到第一个大于等于key的键，然后选择其左边的指针
-        while (i < current->num_keys && key >= current->keys[i]) {
-            i++;
-        }
+        // 找到第一个大于key的键，然后选择其左边的指针
+        int i = count_keys_less_equal(current->keys, current->num_keys, key);
         current = (Node*)current->pointers[i];
     }
     return current;
 }
 
 
+// --- 范围扫描 ---
+
+#if defined(__GNUC__)
+#define PREFETCH(addr) __builtin_prefetch(addr, 0, 3)
+#else
+#define PREFETCH(addr) ((void)0)
+#endif
+
+// 进入一个叶子时预取下一个叶子的节点头和键/指针数组。数组在节点块中的偏移是固定的，
+// 地址直接由节点地址算出，不需要先读下一个叶子的节点头 (那正是预取要隐藏的未命中)
+static void cursor_enter_leaf(BPTreeCursor* cursor, Node* leaf) {
+    cursor->leaf = leaf;
+    cursor->index = 0;
+    if (leaf != NULL && leaf->next != NULL) {
+        char* next = (char*)leaf->next;
+        PREFETCH(next);
+        PREFETCH(next + NODE_KEYS_OFFSET);
+        PREFETCH(next + NODE_POINTERS_OFFSET(cursor->order));
+    }
+}
+
+// 跳过已读完 (或为空) 的叶子
+static void cursor_skip_exhausted(BPTreeCursor* cursor) {
+    while (cursor->leaf != NULL && cursor->index >= cursor->leaf->num_keys) {
+        cursor_enter_leaf(cursor, cursor->leaf->next);
+    }
+}
+
+void open_cursor(BPTree* tree, BPTreeCursor* cursor, int lower, int upper) {
+    cursor->upper = upper;
+    cursor->order = tree->order;
+    if (tree->root == NULL || lower > upper) {
+        cursor->leaf = NULL;
+        return;
+    }
+    Node* leaf = find_leaf(tree->root, lower);
+    cursor_enter_leaf(cursor, leaf);
+
+    cursor->index = count_keys_less(leaf->keys, leaf->num_keys, lower);
+    cursor_skip_exhausted(cursor);
+}
+
+bool cursor_next(BPTreeCursor* cursor, int* key, void** value) {
+    if (cursor->leaf == NULL) return false;
+    Node* leaf = cursor->leaf;
+    if (leaf->keys[cursor->index] > cursor->upper) {
+        cursor->leaf = NULL;
+        return false;
+    }
+    if (key) *key = leaf->keys[cursor->index];
+    if (value) *value = leaf->pointers[cursor->index];
+    cursor->index++;
+    cursor_skip_exhausted(cursor);
+    return true;
+}
+
+int cursor_next_batch(BPTreeCursor* cursor, int* keys, void** values, int max) {
+    int count = 0;
+    while (count < max && cursor->leaf != NULL) {
+        Node* leaf = cursor->leaf;
+        // 一次拷贝当前叶子中剩余且不超过上界的一段
+        int end = leaf->num_keys;
+        if (end - cursor->index > max - count) {
+            end = cursor->index + (max - count);
+        }
+        int i = cursor->index;
+        while (i < end && leaf->keys[i] <= cursor->upper) {
+            if (keys) keys[count] = leaf->keys[i];
+            if (values) values[count] = leaf->pointers[i];
+            count++;
+            i++;
+        }
+        cursor->index = i;
+        if (i < end) {
+            // 遇到了超过上界的键
+            cursor->leaf = NULL;
+            break;
+        }
+        cursor_skip_exhausted(cursor);
+    }
+    return count;
+}
+
+
+// --- 批量查找与插入 ---
+
+#define BATCH_MAX_HEIGHT 64
+
+// 上一个键经过的路径: nodes[i] 是第 i 层的节点，upper[i] 是它覆盖范围的上界 (不包含)。
+// 键按升序到来，所以只需检查上界
+typedef struct BatchPath {
+    Node* nodes[BATCH_MAX_HEIGHT];
+    long long upper[BATCH_MAX_HEIGHT];
+    int depth;      // 有效层数，0 表示需要从根开始
+} BatchPath;
+
+static Node* batch_find_leaf(BPTree* tree, BatchPath* path, int key) {
+    // 向上回退到第一个仍覆盖 key 的祖先
+    int level = path->depth - 1;
+    while (level > 0 && key >= path->upper[level]) {
+        level--;
+    }
+    if (level < 0) {
+        path->nodes[0] = tree->root;
+        path->upper[0] = (long long)INT_MAX + 1;
+        level = 0;
+    }
+
+    Node* node = path->nodes[level];
+    while (!node->is_leaf) {
+        int i = count_keys_less_equal(node->keys, node->num_keys, key);
+        path->upper[level + 1] = (i < node->num_keys) ? node->keys[i] : path->upper[level];
+        node = (Node*)node->pointers[i];
+        path->nodes[++level] = node;
+    }
+    path->depth = level + 1;
+    return node;
+}
+
+typedef struct KeyIndex {
+    int key;
+    int index;
+} KeyIndex;
+
+static int compare_key_index(const void* a, const void* b) {
+    const KeyIndex* x = (const KeyIndex*)a;
+    const KeyIndex* y = (const KeyIndex*)b;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    return x->index - y->index;
+}
+
+// 返回按键排序后的处理顺序 (presorted 时为 NULL，表示按原顺序)
+static KeyIndex* sort_batch(const int* keys, int n, bool presorted) {
+    if (presorted) return NULL;
+    KeyIndex* order = (KeyIndex*)malloc(n * sizeof(KeyIndex));
+    for (int i = 0; i < n; i++) {
+        order[i].key = keys[i];
+        order[i].index = i;
+    }
+    qsort(order, n, sizeof(KeyIndex), compare_key_index);
+    return order;
+}
+
+void search_batch(BPTree* tree, const int* keys, void** values, int n, bool presorted) {
+    if (tree->concurrent) {
+        for (int i = 0; i < n; i++) values[i] = search(tree, keys[i]);
+        return;
+    }
+
+    KeyIndex* order = sort_batch(keys, n, presorted);
+    BatchPath path;
+    path.depth = 0;
+    for (int j = 0; j < n; j++) {
+        int i = order ? order[j].index : j;
+        int key = keys[i];
+        Node* leaf = batch_find_leaf(tree, &path, key);
+        int pos = count_keys_less(leaf->keys, leaf->num_keys, key);
+        values[i] = (pos < leaf->num_keys && leaf->keys[pos] == key) ? leaf->pointers[pos] : NULL;
+    }
+    free(order);
+}
+
+void insert_batch(BPTree* tree, const int* keys, void* const* values, int n, bool presorted) {
+    if (tree->concurrent) {
+        for (int i = 0; i < n; i++) insert(tree, keys[i], values[i]);
+        return;
+    }
+
+    KeyIndex* order = sort_batch(keys, n, presorted);
+    BatchPath path;
+    path.depth = 0;
+    for (int j = 0; j < n; j++) {
+        int i = order ? order[j].index : j;
+        int key = keys[i];
+        Node* leaf = batch_find_leaf(tree, &path, key);
+        int pos = count_keys_less(leaf->keys, leaf->num_keys, key);
+        if (pos < leaf->num_keys && leaf->keys[pos] == key) {
+            continue;
+        }
+        if (leaf->num_keys < tree->order - 1) {
+            // 叶子内插入不改变任何节点的范围，路径继续有效
+            insert_into_leaf(leaf, key, values[i]);
+        } else {
+            split_leaf_and_insert(tree, leaf, key, values[i]);
+            path.depth = 0;
+        }
+    }
+    free(order);
+}
+
+
 // --- 插入操作 ---
 
 void insert(BPTree* tree, int key, void* value) {
+    if (tree->concurrent) {
+        insert_concurrent(tree, key, value);
+        return;
+    }
+
     // 检查键是否已存在 (B+树通常不允许重复键)
     if (search(tree, key) != NULL) {
         // 在真实实现中，可以选择更新值或返回错误
@@ -92,10 +564,7 @@ void insert(BPTree* tree, int key, void* value) {
 }
 
 void insert_into_leaf(Node* leaf, int key, void* value) {
-    int i = 0;
-    while (i < leaf->num_keys && leaf->keys[i] < key) {
-        i++;
-    }
+    int i = count_keys_less(leaf->keys, leaf->num_keys, key);
     for (int j = leaf->num_keys; j > i; j--) {
         leaf->keys[j] = leaf->keys[j - 1];
         leaf->pointers[j] = leaf->pointers[j - 1];
@@ -106,14 +575,11 @@ void insert_into_leaf(Node* leaf, int key, void* value) {
 }
 
 void split_leaf_and_insert(BPTree* tree, Node* leaf, int key, void* value) {
-    Node* new_leaf = create_node(tree->order, true);
-    int* temp_keys = (int*)malloc(tree->order * sizeof(int));
-    void** temp_pointers = (void**)malloc(tree->order * sizeof(void*));
+    Node* new_leaf = create_node(tree, true);
+    int* temp_keys = tree->scratch_keys;
+    void** temp_pointers = tree->scratch_pointers;
 
-    int insertion_point = 0;
-    while (insertion_point < tree->order - 1 && leaf->keys[insertion_point] < key) {
-        insertion_point++;
-    }
+    int insertion_point = count_keys_less(leaf->keys, tree->order - 1, key);
 
     for (int i = 0, j = 0; i < leaf->num_keys; i++, j++) {
         if (j == insertion_point) j++;
@@ -136,9 +602,6 @@ void split_leaf_and_insert(BPTree* tree, Node* leaf, int key, void* value) {
         new_leaf->pointers[i] = temp_pointers[j];
     }
 
-    free(temp_keys);
-    free(temp_pointers);
-
     new_leaf->next = leaf->next;
     leaf->next = new_leaf;
 
@@ -178,9 +641,10 @@ void insert_into_internal(Node* node, int left_index, int key, Node* right) {
 
 // 【已补全】分裂内部节点
 void split_internal_and_insert(BPTree* tree, Node* old_node, int left_index, int key, Node* right) {
-    // 1. 创建临时空间，容纳所有旧键/指针和新键/指针
-    int temp_keys[tree->order];
-    Node* temp_pointers[tree->order + 1];
+    // 1. 使用树的分裂临时区，容纳所有旧键/指针和新键/指针
+    //    (递归调用 insert_into_parent 之前已经用完，可以安全复用)
+    int* temp_keys = tree->scratch_keys;
+    Node** temp_pointers = (Node**)tree->scratch_pointers;
 
     for (int i = 0, j = 0; i < old_node->num_keys + 1; i++, j++) {
         if (j == left_index + 1) j++;
@@ -198,7 +662,7 @@ void split_internal_and_insert(BPTree* tree, Node* old_node, int left_index, int
     int key_to_promote = temp_keys[split];
     
     // 3. 创建新内部节点，并分配键和指针
-    Node* new_node = create_node(tree->order, false);
+    Node* new_node = create_node(tree, false);
     old_node->num_keys = split;
     for (int i = 0; i < split; i++) {
         old_node->keys[i] = temp_keys[i];
@@ -225,7 +689,7 @@ void split_internal_and_insert(BPTree* tree, Node* old_node, int left_index, int
 }
 
 void insert_into_new_root(BPTree* tree, Node* left, int key, Node* right) {
-    Node* new_root = create_node(tree->order, false);
+    Node* new_root = create_node(tree, false);
     new_root->keys[0] = key;
     new_root->pointers[0] = left;
     new_root->pointers[1] = right;
@@ -236,6 +700,422 @@ void insert_into_new_root(BPTree* tree, Node* left, int key, Node* right) {
 }
 
 
+// --- 删除操作 ---
+
+void set_lazy_delete(BPTree* tree, bool lazy) {
+    tree->lazy_delete = lazy;
+}
+
+bool remove_key(BPTree* tree, int key) {
+    if (tree->concurrent) return remove_concurrent(tree, key);
+
+    Node* leaf = find_leaf(tree->root, key);
+    int i = count_keys_less(leaf->keys, leaf->num_keys, key);
+    if (i >= leaf->num_keys || leaf->keys[i] != key) {
+        return false;
+    }
+    for (int j = i; j < leaf->num_keys - 1; j++) {
+        leaf->keys[j] = leaf->keys[j + 1];
+        leaf->pointers[j] = leaf->pointers[j + 1];
+    }
+    leaf->num_keys--;
+
+    if (!tree->lazy_delete) {
+        rebalance_after_remove(tree, leaf);
+    }
+    return true;
+}
+
+// 把 right 的全部内容并入 left，并从父节点中删掉二者之间的分隔键 (下标 separator_index)
+static void merge_nodes(BPTree* tree, Node* left, Node* right, int separator_index) {
+    Node* parent = left->parent;
+    if (left->is_leaf) {
+        for (int i = 0; i < right->num_keys; i++) {
+            left->keys[left->num_keys + i] = right->keys[i];
+            left->pointers[left->num_keys + i] = right->pointers[i];
+        }
+        left->num_keys += right->num_keys;
+        left->next = right->next;
+    } else {
+        // 内部节点合并时，父节点中的分隔键下移到两部分之间
+        left->keys[left->num_keys] = parent->keys[separator_index];
+        for (int i = 0; i < right->num_keys; i++) {
+            left->keys[left->num_keys + 1 + i] = right->keys[i];
+        }
+        for (int i = 0; i <= right->num_keys; i++) {
+            Node* child = (Node*)right->pointers[i];
+            left->pointers[left->num_keys + 1 + i] = child;
+            child->parent = left;
+        }
+        left->num_keys += right->num_keys + 1;
+    }
+
+    for (int i = separator_index; i < parent->num_keys - 1; i++) {
+        parent->keys[i] = parent->keys[i + 1];
+        parent->pointers[i + 1] = parent->pointers[i + 2];
+    }
+    parent->num_keys--;
+    free_node(tree, right);
+}
+
+// 从左兄弟借最后一个条目放到 node 最前面
+static void borrow_from_left(Node* node, Node* left, int separator_index) {
+    Node* parent = node->parent;
+    for (int i = node->num_keys; i > 0; i--) {
+        node->keys[i] = node->keys[i - 1];
+    }
+    if (node->is_leaf) {
+        for (int i = node->num_keys; i > 0; i--) {
+            node->pointers[i] = node->pointers[i - 1];
+        }
+        node->keys[0] = left->keys[left->num_keys - 1];
+        node->pointers[0] = left->pointers[left->num_keys - 1];
+        parent->keys[separator_index] = node->keys[0];
+    } else {
+        for (int i = node->num_keys + 1; i > 0; i--) {
+            node->pointers[i] = node->pointers[i - 1];
+        }
+        Node* child = (Node*)left->pointers[left->num_keys];
+        node->keys[0] = parent->keys[separator_index];
+        node->pointers[0] = child;
+        child->parent = node;
+        parent->keys[separator_index] = left->keys[left->num_keys - 1];
+    }
+    node->num_keys++;
+    left->num_keys--;
+}
+
+// 从右兄弟借第一个条目放到 node 末尾
+static void borrow_from_right(Node* node, Node* right, int separator_index) {
+    Node* parent = node->parent;
+    if (node->is_leaf) {
+        node->keys[node->num_keys] = right->keys[0];
+        node->pointers[node->num_keys] = right->pointers[0];
+        for (int i = 0; i < right->num_keys - 1; i++) {
+            right->keys[i] = right->keys[i + 1];
+            right->pointers[i] = right->pointers[i + 1];
+        }
+        parent->keys[separator_index] = right->keys[0];
+    } else {
+        Node* child = (Node*)right->pointers[0];
+        node->keys[node->num_keys] = parent->keys[separator_index];
+        node->pointers[node->num_keys + 1] = child;
+        child->parent = node;
+        parent->keys[separator_index] = right->keys[0];
+        for (int i = 0; i < right->num_keys - 1; i++) {
+            right->keys[i] = right->keys[i + 1];
+        }
+        for (int i = 0; i < right->num_keys; i++) {
+            right->pointers[i] = right->pointers[i + 1];
+        }
+    }
+    node->num_keys++;
+    right->num_keys--;
+}
+
+void rebalance_after_remove(BPTree* tree, Node* node) {
+    if (node == tree->root) {
+        // 根是只剩一个孩子的内部节点时，孩子成为新根，树变矮一层
+        if (!node->is_leaf && node->num_keys == 0) {
+            tree->root = (Node*)node->pointers[0];
+            tree->root->parent = NULL;
+            free_node(tree, node);
+        }
+        return;
+    }
+
+    // 与分裂后的最小占用保持一致: 叶子至少 order/2 个键，内部节点至少 ceil(order/2) 个孩子
+    int min_keys = node->is_leaf ? tree->order / 2 : (tree->order + 1) / 2 - 1;
+    if (node->num_keys >= min_keys) return;
+
+    Node* parent = node->parent;
+    int index = 0;
+    while (index <= parent->num_keys && parent->pointers[index] != node) {
+        index++;
+    }
+
+    // 优先使用左兄弟，最左边的孩子使用右兄弟
+    bool use_left = index > 0;
+    int separator_index = use_left ? index - 1 : 0;
+    Node* neighbor = (Node*)parent->pointers[use_left ? index - 1 : 1];
+    int merged_keys = node->num_keys + neighbor->num_keys + (node->is_leaf ? 0 : 1);
+
+    if (merged_keys <= tree->order - 1) {
+        if (use_left) {
+            merge_nodes(tree, neighbor, node, separator_index);
+        } else {
+            merge_nodes(tree, node, neighbor, separator_index);
+        }
+        rebalance_after_remove(tree, parent);
+    } else if (use_left) {
+        borrow_from_left(node, neighbor, separator_index);
+    } else {
+        borrow_from_right(node, neighbor, separator_index);
+    }
+}
+
+// --- 压缩 ---
+
+static bool next_from_cursor(void* ctx, int* key, void** value) {
+    return cursor_next((BPTreeCursor*)ctx, key, value);
+}
+
+// 交换两个同阶内存池中的节点 (chunk 链表、空闲列表和计数)。锁留在原处，不能按值复制
+static void swap_arena_nodes(NodeArena* a, NodeArena* b) {
+    NodeChunk* chunks = a->chunks;
+    a->chunks = b->chunks;
+    b->chunks = chunks;
+    char* bump = a->bump;
+    a->bump = b->bump;
+    b->bump = bump;
+    char* bump_end = a->bump_end;
+    a->bump_end = b->bump_end;
+    b->bump_end = bump_end;
+    void* free_list = a->free_list;
+    a->free_list = b->free_list;
+    b->free_list = free_list;
+    size_t chunk_count = a->chunk_count;
+    a->chunk_count = b->chunk_count;
+    b->chunk_count = chunk_count;
+    size_t nodes_in_use = a->nodes_in_use;
+    a->nodes_in_use = b->nodes_in_use;
+    b->nodes_in_use = nodes_in_use;
+}
+
+bool compact_tree(BPTree* tree, double fill_factor) {
+    BPTreeCursor cursor;
+    int n = 0;
+    open_cursor(tree, &cursor, INT_MIN, INT_MAX);
+    while (cursor_next(&cursor, NULL, NULL)) {
+        n++;
+    }
+
+    open_cursor(tree, &cursor, INT_MIN, INT_MAX);
+    BPTree* rebuilt = bulk_load_bptree_stream(tree->order, n, next_from_cursor, &cursor, fill_factor);
+    if (rebuilt == NULL) return false;
+
+    // 只把新树的根和节点换进原来的句柄，旧的节点随 rebuilt 一起整块释放
+    Node* root = tree->root;
+    tree->root = rebuilt->root;
+    rebuilt->root = root;
+    swap_arena_nodes(&tree->arena, &rebuilt->arena);
+    destroy_tree(rebuilt);
+    return true;
+}
+
+
+// --- 并发模式: 乐观锁耦合 ---
+// 读者: 读版本 (等待写锁释放) -> 读节点 -> 校验版本未变，否则从根重来。
+// 写者: 用 CAS 把读到的版本升级为写锁，成功说明从读取到加锁之间节点没有被修改。
+// 节点内容在读者读取时可能正被修改，所以读出的 num_keys 要截断到合法范围，
+// 子指针在校验版本之后才解引用。
+
+#define VERSION_OBSOLETE 1ULL
+#define VERSION_LOCKED 2ULL
+
+static inline uint64_t read_lock_or_restart(Node* node, bool* need_restart) {
+    uint64_t version = __atomic_load_n(&node->version, __ATOMIC_ACQUIRE);
+    while (version & VERSION_LOCKED) {
+        sched_yield();
+        version = __atomic_load_n(&node->version, __ATOMIC_ACQUIRE);
+    }
+    if (version & VERSION_OBSOLETE) *need_restart = true;
+    return version;
+}
+
+static inline void read_unlock_or_restart(Node* node, uint64_t version, bool* need_restart) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&node->version, __ATOMIC_RELAXED) != version) *need_restart = true;
+}
+
+static inline void upgrade_to_write_lock_or_restart(Node* node, uint64_t version, bool* need_restart) {
+    if (!__atomic_compare_exchange_n(&node->version, &version, version + VERSION_LOCKED,
+                                     false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        *need_restart = true;
+    }
+}
+
+static inline void write_unlock(Node* node) {
+    __atomic_fetch_add(&node->version, VERSION_LOCKED, __ATOMIC_RELEASE);
+}
+
+static inline int load_num_keys(BPTree* tree, Node* node) {
+    int n = __atomic_load_n(&node->num_keys, __ATOMIC_RELAXED);
+    if (n < 0) return 0;
+    return n > tree->order - 1 ? tree->order - 1 : n;
+}
+
+static inline Node* load_root(BPTree* tree) {
+    return __atomic_load_n(&tree->root, __ATOMIC_ACQUIRE);
+}
+
+// 把已锁定的满节点对半分开 (不插入新键)，返回右半部分，*separator 为要放入父节点的分隔键
+static Node* split_node_in_half(BPTree* tree, Node* node, int* separator) {
+    Node* right = create_node(tree, node->is_leaf);
+    int n = node->num_keys;
+    int mid = n / 2;
+    if (node->is_leaf) {
+        right->num_keys = n - mid;
+        for (int i = 0; i < right->num_keys; i++) {
+            right->keys[i] = node->keys[mid + i];
+            right->pointers[i] = node->pointers[mid + i];
+        }
+        right->next = node->next;
+        *separator = right->keys[0];
+        __atomic_store_n(&node->next, right, __ATOMIC_RELEASE);
+    } else {
+        // 中间键上移，右节点得到它之后的键和子指针
+        right->num_keys = n - mid - 1;
+        for (int i = 0; i < right->num_keys; i++) {
+            right->keys[i] = node->keys[mid + 1 + i];
+        }
+        for (int i = 0; i <= right->num_keys; i++) {
+            right->pointers[i] = node->pointers[mid + 1 + i];
+        }
+        *separator = node->keys[mid];
+    }
+    __atomic_store_n(&node->num_keys, mid, __ATOMIC_RELAXED);
+    return right;
+}
+
+void insert_concurrent(BPTree* tree, int key, void* value) {
+restart:;
+    bool need_restart = false;
+    Node* node = load_root(tree);
+    uint64_t version = read_lock_or_restart(node, &need_restart);
+    if (need_restart || node != load_root(tree)) goto restart;
+
+    Node* parent = NULL;
+    uint64_t parent_version = 0;
+    while (true) {
+        int n = load_num_keys(tree, node);
+
+        // 满节点在下降时就分裂，此时父节点一定还有空位 (它在上一层已经检查过)
+        if (n >= tree->order - 1) {
+            if (parent != NULL) {
+                upgrade_to_write_lock_or_restart(parent, parent_version, &need_restart);
+                if (need_restart) goto restart;
+            }
+            upgrade_to_write_lock_or_restart(node, version, &need_restart);
+            if (need_restart) {
+                if (parent != NULL) write_unlock(parent);
+                goto restart;
+            }
+            if (parent == NULL && node != load_root(tree)) {
+                // 节点在我们加锁之前已经不再是根
+                write_unlock(node);
+                goto restart;
+            }
+
+            int separator;
+            Node* right = split_node_in_half(tree, node, &separator);
+            if (parent != NULL) {
+                int left_index = count_keys_less_equal(parent->keys, parent->num_keys, separator);
+                insert_into_internal(parent, left_index, separator, right);
+                write_unlock(parent);
+            } else {
+                Node* new_root = create_node(tree, false);
+                new_root->keys[0] = separator;
+                new_root->pointers[0] = node;
+                new_root->pointers[1] = right;
+                new_root->num_keys = 1;
+                __atomic_store_n(&tree->root, new_root, __ATOMIC_RELEASE);
+            }
+            write_unlock(node);
+            goto restart;
+        }
+
+        if (parent != NULL) {
+            read_unlock_or_restart(parent, parent_version, &need_restart);
+            if (need_restart) goto restart;
+        }
+        if (__atomic_load_n(&node->is_leaf, __ATOMIC_RELAXED)) break;
+
+        parent = node;
+        parent_version = version;
+        int i = count_keys_less_equal(node->keys, n, key);
+        Node* child = __atomic_load_n((Node**)&node->pointers[i], __ATOMIC_RELAXED);
+        read_unlock_or_restart(node, version, &need_restart);
+        if (need_restart) goto restart;
+
+        node = child;
+        version = read_lock_or_restart(node, &need_restart);
+        if (need_restart) goto restart;
+    }
+
+    upgrade_to_write_lock_or_restart(node, version, &need_restart);
+    if (need_restart) goto restart;
+    int i = count_keys_less(node->keys, node->num_keys, key);
+    if (i >= node->num_keys || node->keys[i] != key) {
+        insert_into_leaf(node, key, value);
+    }
+    write_unlock(node);
+}
+
+// 乐观地从根下降到 key 所在的叶子，返回叶子和读到的版本 (尚未校验)
+static Node* find_leaf_optimistic(BPTree* tree, int key, uint64_t* leaf_version) {
+restart:;
+    bool need_restart = false;
+    Node* node = load_root(tree);
+    uint64_t version = read_lock_or_restart(node, &need_restart);
+    if (need_restart || node != load_root(tree)) goto restart;
+
+    while (!__atomic_load_n(&node->is_leaf, __ATOMIC_RELAXED)) {
+        Node* parent = node;
+        uint64_t parent_version = version;
+        int i = count_keys_less_equal(node->keys, load_num_keys(tree, node), key);
+        Node* child = __atomic_load_n((Node**)&node->pointers[i], __ATOMIC_RELAXED);
+        read_unlock_or_restart(parent, parent_version, &need_restart);
+        if (need_restart) goto restart;
+
+        node = child;
+        version = read_lock_or_restart(node, &need_restart);
+        if (need_restart) goto restart;
+        // 子节点加读锁之后再校验一次父节点，保证子节点此时仍覆盖 key 所在的范围
+        read_unlock_or_restart(parent, parent_version, &need_restart);
+        if (need_restart) goto restart;
+    }
+    *leaf_version = version;
+    return node;
+}
+
+void* search_concurrent(BPTree* tree, int key) {
+    while (true) {
+        bool need_restart = false;
+        uint64_t version;
+        Node* leaf = find_leaf_optimistic(tree, key, &version);
+        int n = load_num_keys(tree, leaf);
+        int i = count_keys_less(leaf->keys, n, key);
+        void* value = (i < n && leaf->keys[i] == key) ? leaf->pointers[i] : NULL;
+        read_unlock_or_restart(leaf, version, &need_restart);
+        if (!need_restart) return value;
+    }
+}
+
+// 并发删除只修改叶子，不做合并，空间由 compact_tree 回收
+bool remove_concurrent(BPTree* tree, int key) {
+    while (true) {
+        bool need_restart = false;
+        uint64_t version;
+        Node* leaf = find_leaf_optimistic(tree, key, &version);
+        upgrade_to_write_lock_or_restart(leaf, version, &need_restart);
+        if (need_restart) continue;
+
+        int i = count_keys_less(leaf->keys, leaf->num_keys, key);
+        bool found = i < leaf->num_keys && leaf->keys[i] == key;
+        if (found) {
+            for (int j = i; j < leaf->num_keys - 1; j++) {
+                leaf->keys[j] = leaf->keys[j + 1];
+                leaf->pointers[j] = leaf->pointers[j + 1];
+            }
+            leaf->num_keys--;
+        }
+        write_unlock(leaf);
+        return found;
+    }
+}
+
+
 // --- 打印函数 ---
 
 void print_leaves(BPTree* tree) {
@@ -4,9 +4,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <limits.h>
+#include <stdint.h>
+#include <pthread.h>
 
 // B+ 树节点
+// 节点头、keys 和 pointers 由 create_node 一次分配在同一块按缓存行对齐的内存中
+// version 是并发模式下的节点版本锁: bit0 表示节点已废弃，bit1 表示被写者锁定，
+// 其余位是修改计数。读者只读取它，不写节点所在的缓存行
 typedef struct Node {
+    uint64_t version;
     bool is_leaf;
     int num_keys;
     int* keys;
@@ -15,24 +22,107 @@ typedef struct Node {
     struct Node* next; // 用于连接叶子节点的链表
 } Node;
 
+// 节点内存池 (slab): 同一棵树的所有节点大小相同，从大块内存 (chunk) 中顺序切分，
+// 被回收的节点进入空闲链表优先复用。销毁树时按 chunk 整块释放，不再逐个节点递归 free
+typedef struct NodeChunk {
+    struct NodeChunk* next;
+} NodeChunk;
+
+typedef struct NodeArena {
+    size_t node_size;           // 每个节点块的字节数 (已按缓存行对齐)
+    int nodes_per_chunk;
+    NodeChunk* chunks;          // 已申请的 chunk 链表
+    char* bump;                 // 当前 chunk 中下一个未切分的位置
+    char* bump_end;
+    void* free_list;            // 回收的节点块，块首存放下一个空闲块的地址
+    size_t chunk_count;
+    size_t nodes_in_use;
+    pthread_mutex_t lock;       // 并发模式下保护内存池
+} NodeArena;
+
+// 内存使用统计
+typedef struct BPTreeMemStats {
+    size_t bytes_reserved;      // 向系统申请的总字节数 (chunk + 分裂临时区)
+    size_t bytes_in_use;        // 正在使用的节点占用的字节数
+    size_t node_count;          // 正在使用的节点数
+    size_t chunk_count;         // 已申请的 chunk 数
+} BPTreeMemStats;
+
 // B+ 树结构
 typedef struct BPTree {
     Node* root;
     int order;
+    NodeArena arena;            // 节点内存池
+    int* scratch_keys;          // 分裂时使用的临时区，大小为 order + 1，随树一起分配
+    void** scratch_pointers;
+    bool concurrent;            // 是否为并发模式 (见 create_concurrent_bptree)
+    bool lazy_delete;           // 延迟合并模式 (见 set_lazy_delete)
 } BPTree;
 
+// 范围扫描游标: 沿叶子链表顺序读取 [lower, upper] 内的键值对
+typedef struct BPTreeCursor {
+    Node* leaf;     // 当前叶子，扫描结束时为 NULL
+    int index;      // 下一个要读取的条目在当前叶子中的位置
+    int upper;      // 上界 (包含)
+    int order;      // 树的阶数，预取下一个叶子时由它算出指针数组的地址
+} BPTreeCursor;
+
 // --- 函数声明 ---
 
 // 创建与销毁
 BPTree* create_bptree(int order);
+// 并发模式: insert/search 可以被多个线程同时调用，基于节点版本锁的乐观锁耦合
+// (optimistic lock coupling)。读者不加锁，只在读完节点后校验版本；写者在下降
+// 过程中遇到满节点就提前分裂 (同时锁住父节点)，因此分裂不会向上级联。
+// 并发模式下不维护 parent 指针；游标、批量构建和打印仍需调用者保证没有并发写者。
+BPTree* create_concurrent_bptree(int order);
 void destroy_tree(BPTree* tree);
+void get_memory_stats(BPTree* tree, BPTreeMemStats* stats);
+int get_tree_height(BPTree* tree);
 
 // 插入
 void insert(BPTree* tree, int key, void* value);
 
+// 批量构建: 从严格递增的键值序列自底向上构建整棵树，不经过逐条插入。
+// fill_factor 为每个节点的目标填充率，取值 (0, 1]，小于半满时按半满处理。
+// 输入不是严格递增时返回 NULL。
+// 流式版本通过 next 依次取出 n 个键值对，next 返回 false 视为输入提前结束。
+typedef bool (*kv_source_fn)(void* ctx, int* key, void** value);
+BPTree* bulk_load_bptree(int order, const int* keys, void* const* values, int n, double fill_factor);
+BPTree* bulk_load_bptree_stream(int order, int n, kv_source_fn next, void* ctx, double fill_factor);
+
+// 删除，键不存在时返回 false。
+// 默认在节点低于半满时向兄弟节点借键或与之合并，必要时树会变矮。
+// 延迟模式下只从叶子中删除条目，不做借键/合并 (叶子可能变空)，
+// 之后由 compact_tree 统一重建；并发模式下删除总是延迟的。
+bool remove_key(BPTree* tree, int key);
+void set_lazy_delete(BPTree* tree, bool lazy);
+
+// 压缩: 按 fill_factor 自底向上重建整棵树，回收延迟删除留下的空间。
+// 新树建好后整块释放旧的节点内存池。这是独占操作，不能和任何读写并行:
+// 并发模式下调用者也必须先停下所有访问这棵树的线程。
+// 重建失败时返回 false，原树不变。
+bool compact_tree(BPTree* tree, double fill_factor);
+
 // 查找
 void* search(BPTree* tree, int key);
 
+// 范围扫描: open_cursor 定位到第一个 >= lower 的键，之后按键序读取，
+// 直到超过 upper (不需要上界时传 INT_MAX)。
+// cursor_next 每次返回一个条目，读完返回 false；
+// cursor_next_batch 最多读取 max 个条目到调用者的缓冲区，返回实际个数 (0 表示结束)。
+void open_cursor(BPTree* tree, BPTreeCursor* cursor, int lower, int upper);
+bool cursor_next(BPTreeCursor* cursor, int* key, void** value);
+int cursor_next_batch(BPTreeCursor* cursor, int* keys, void** values, int max);
+
+// 批量接口: 一次处理 n 个键，按键序处理时相邻的键共享从根到叶子的路径，
+// 只要下一个键仍落在当前叶子 (或某个祖先) 的范围内，就不必从根重新下降。
+// presorted 为 true 表示 keys 已按升序排列，否则内部先排序 (结果仍按原顺序返回)。
+// search_batch 把 keys[i] 的查找结果写入 values[i]；insert_batch 中已存在的键被忽略。
+// 并发模式下逐个调用 search/insert。
+void search_batch(BPTree* tree, const int* keys, void** values, int n, bool presorted);
+void insert_batch(BPTree* tree, const int* keys, void* const* values, int n, bool presorted);
+
 // 打印 (用于调试和展示)
 void print_tree(BPTree* tree);
 void print_leaves(BPTree* tree);
@@ -0,0 +1,256 @@
+#ifndef BPTREE_HPP
+#define BPTREE_HPP
+
+// 头文件模板版 B+ 树: 键类型、值类型、节点容量和比较器都是模板参数。
+// 节点大小在编译期确定，值直接内联存放在叶子中 (不再经过 void* 间接访问)。
+// 节点内查找循环到运行时的键数，循环体不依赖比较结果分支 (见 count_less)。
+
+#include <cstddef>
+#include <functional>
+#include <utility>
+
+namespace dblab {
+
+template <typename Key, typename Value, int Capacity = 64, typename Compare = std::less<Key>>
+class BPTree {
+    static_assert(Capacity >= 3, "node capacity must be at least 3");
+
+    struct NodeBase {
+        bool is_leaf;
+        int num_keys;
+    };
+
+    // 键/值数组多留一个位置，插入时先放进去再判断是否需要分裂
+    struct alignas(64) Leaf : NodeBase {
+        Key keys[Capacity + 1];
+        Value values[Capacity + 1];
+        Leaf* next;
+    };
+
+    struct alignas(64) Inner : NodeBase {
+        Key keys[Capacity + 1];
+        NodeBase* children[Capacity + 2];
+    };
+
+    // 子节点分裂后需要插入父节点的分隔键和右半部分
+    struct Split {
+        bool happened;
+        Key separator;
+        NodeBase* right;
+    };
+
+public:
+    // 只读迭代器，沿叶子链表按键序前进
+    class const_iterator {
+    public:
+        const_iterator() : leaf_(nullptr), index_(0) {}
+        const Key& key() const { return leaf_->keys[index_]; }
+        const Value& value() const { return leaf_->values[index_]; }
+        bool operator==(const const_iterator& other) const {
+            return leaf_ == other.leaf_ && index_ == other.index_;
+        }
+        bool operator!=(const const_iterator& other) const { return !(*this == other); }
+        const_iterator& operator++() {
+            if (++index_ >= leaf_->num_keys) {
+                leaf_ = leaf_->next;
+                index_ = 0;
+                skip_empty();
+            }
+            return *this;
+        }
+
+    private:
+        friend class BPTree;
+        const_iterator(const Leaf* leaf, int index) : leaf_(leaf), index_(index) { skip_empty(); }
+        void skip_empty() {
+            while (leaf_ != nullptr && index_ >= leaf_->num_keys) {
+                leaf_ = leaf_->next;
+                index_ = 0;
+            }
+        }
+        const Leaf* leaf_;
+        int index_;
+    };
+
+    explicit BPTree(Compare compare = Compare()) : root_(new_leaf()), size_(0), compare_(compare) {}
+    ~BPTree() { destroy(root_); }
+
+    BPTree(const BPTree&) = delete;
+    BPTree& operator=(const BPTree&) = delete;
+
+    // 插入，键已存在时不修改并返回 false
+    bool insert(const Key& key, const Value& value) {
+        bool inserted = false;
+        Split split = insert_into(root_, key, value, &inserted);
+        if (split.happened) {
+            Inner* root = new Inner();
+            root->is_leaf = false;
+            root->num_keys = 1;
+            root->keys[0] = split.separator;
+            root->children[0] = root_;
+            root->children[1] = split.right;
+            root_ = root;
+        }
+        if (inserted) size_++;
+        return inserted;
+    }
+
+    // 查找，不存在时返回 nullptr
+    const Value* find(const Key& key) const {
+        const Leaf* leaf = find_leaf(key);
+        int i = count_less(leaf->keys, leaf->num_keys, key);
+        if (i < leaf->num_keys && !compare_(key, leaf->keys[i])) {
+            return &leaf->values[i];
+        }
+        return nullptr;
+    }
+
+    Value* find(const Key& key) {
+        return const_cast<Value*>(static_cast<const BPTree*>(this)->find(key));
+    }
+
+    // 第一个不小于 key 的位置，用于范围扫描
+    const_iterator lower_bound(const Key& key) const {
+        const Leaf* leaf = find_leaf(key);
+        return const_iterator(leaf, count_less(leaf->keys, leaf->num_keys, key));
+    }
+
+    const_iterator begin() const {
+        const NodeBase* node = root_;
+        while (!node->is_leaf) {
+            node = static_cast<const Inner*>(node)->children[0];
+        }
+        return const_iterator(static_cast<const Leaf*>(node), 0);
+    }
+
+    const_iterator end() const { return const_iterator(); }
+
+    std::size_t size() const { return size_; }
+
+    int height() const {
+        int h = 1;
+        for (const NodeBase* node = root_; !node->is_leaf; h++) {
+            node = static_cast<const Inner*>(node)->children[0];
+        }
+        return h;
+    }
+
+private:
+    // 节点内有序，统计比 key 小的键的个数即得到插入位置。
+    // 循环到运行时的键数 n (不超过编译期的容量)，循环体没有依赖比较结果的分支，
+    // 节点很小时比二分查找的分支预测失败更便宜
+    int count_less(const Key* keys, int n, const Key& key) const {
+        int count = 0;
+        for (int i = 0; i < n; i++) count += compare_(keys[i], key);
+        return count;
+    }
+
+    int count_less_equal(const Key* keys, int n, const Key& key) const {
+        int count = 0;
+        for (int i = 0; i < n; i++) count += !compare_(key, keys[i]);
+        return count;
+    }
+
+    static Leaf* new_leaf() {
+        Leaf* leaf = new Leaf();
+        leaf->is_leaf = true;
+        leaf->num_keys = 0;
+        leaf->next = nullptr;
+        return leaf;
+    }
+
+    const Leaf* find_leaf(const Key& key) const {
+        const NodeBase* node = root_;
+        while (!node->is_leaf) {
+            const Inner* inner = static_cast<const Inner*>(node);
+            node = inner->children[count_less_equal(inner->keys, inner->num_keys, key)];
+        }
+        return static_cast<const Leaf*>(node);
+    }
+
+    Split insert_into(NodeBase* node, const Key& key, const Value& value, bool* inserted) {
+        if (node->is_leaf) {
+            Leaf* leaf = static_cast<Leaf*>(node);
+            int pos = count_less(leaf->keys, leaf->num_keys, key);
+            if (pos < leaf->num_keys && !compare_(key, leaf->keys[pos])) {
+                return Split{false, Key(), nullptr};
+            }
+            for (int i = leaf->num_keys; i > pos; i--) {
+                leaf->keys[i] = std::move(leaf->keys[i - 1]);
+                leaf->values[i] = std::move(leaf->values[i - 1]);
+            }
+            leaf->keys[pos] = key;
+            leaf->values[pos] = value;
+            leaf->num_keys++;
+            *inserted = true;
+            return leaf->num_keys > Capacity ? split_leaf(leaf) : Split{false, Key(), nullptr};
+        }
+
+        Inner* inner = static_cast<Inner*>(node);
+        int index = count_less_equal(inner->keys, inner->num_keys, key);
+        Split child = insert_into(inner->children[index], key, value, inserted);
+        if (!child.happened) return child;
+
+        for (int i = inner->num_keys; i > index; i--) {
+            inner->keys[i] = std::move(inner->keys[i - 1]);
+            inner->children[i + 1] = inner->children[i];
+        }
+        inner->keys[index] = child.separator;
+        inner->children[index + 1] = child.right;
+        inner->num_keys++;
+        return inner->num_keys > Capacity ? split_inner(inner) : Split{false, Key(), nullptr};
+    }
+
+    Split split_leaf(Leaf* leaf) {
+        Leaf* right = new_leaf();
+        int split = leaf->num_keys / 2;
+        right->num_keys = leaf->num_keys - split;
+        for (int i = 0; i < right->num_keys; i++) {
+            right->keys[i] = std::move(leaf->keys[split + i]);
+            right->values[i] = std::move(leaf->values[split + i]);
+        }
+        leaf->num_keys = split;
+        right->next = leaf->next;
+        leaf->next = right;
+        return Split{true, right->keys[0], right};
+    }
+
+    Split split_inner(Inner* inner) {
+        Inner* right = new Inner();
+        right->is_leaf = false;
+        int split = inner->num_keys / 2;
+        right->num_keys = inner->num_keys - split - 1;
+        for (int i = 0; i < right->num_keys; i++) {
+            right->keys[i] = std::move(inner->keys[split + 1 + i]);
+        }
+        for (int i = 0; i <= right->num_keys; i++) {
+            right->children[i] = inner->children[split + 1 + i];
+        }
+        inner->num_keys = split;
+        return Split{true, inner->keys[split], right};
+    }
+
+    void destroy(NodeBase* node) {
+        if (node->is_leaf) {
+            delete static_cast<Leaf*>(node);
+            return;
+        }
+        Inner* inner = static_cast<Inner*>(node);
+        for (int i = 0; i <= inner->num_keys; i++) {
+            destroy(inner->children[i]);
+        }
+        delete inner;
+    }
+
+    NodeBase* root_;
+    std::size_t size_;
+    Compare compare_;
+};
+
+// 与 C 接口 (bptree.h) 相同的键值类型: int 键、void* 值，方便 C++ 代码按原语义迁移
+template <int Capacity = 64>
+using IntPtrBPTree = BPTree<int, void*, Capacity>;
+
+} // namespace dblab
+
+#endif // BPTREE_HPP
@@ -0,0 +1,368 @@
+#include "disk_bptree.h"
+
+// --- 页内布局访问 ---
+
+#define NODE_HEADER(page) ((DiskNodeHeader*)(page)->data)
+#define NODE_KEYS(page) ((int*)((page)->data + sizeof(DiskNodeHeader)))
+#define LEAF_VALUES(page) ((disk_value_t*)(NODE_KEYS(page) + DISK_LEAF_MAX_KEYS))
+#define INTERNAL_CHILDREN(page) ((page_id_t*)(NODE_KEYS(page) + DISK_INTERNAL_MAX_KEYS))
+
+// --- 内部辅助函数声明 ---
+Page* new_disk_node(DiskBPTree* tree, page_id_t* page_id, bool is_leaf);
+bool set_disk_root(DiskBPTree* tree, page_id_t root_page_id);
+int internal_child_index(Page* page, int key);
+
+// --- 创建、打开与关闭 ---
+
+DiskBPTree* create_disk_bptree(BufferPoolManager* bpm) {
+    DiskBPTree* tree = (DiskBPTree*)malloc(sizeof(DiskBPTree));
+    tree->bpm = bpm;
+
+    Page* meta = new_page(bpm, &tree->meta_page_id);
+    if (meta == NULL) {
+        free(tree);
+        return NULL;
+    }
+    unpin_page(bpm, tree->meta_page_id, false);
+
+    Page* root = new_disk_node(tree, &tree->root_page_id, true);
+    if (root == NULL) {
+        free(tree);
+        return NULL;
+    }
+    unpin_page(bpm, tree->root_page_id, true);
+
+    if (!set_disk_root(tree, tree->root_page_id)) {
+        free(tree);
+        return NULL;
+    }
+    return tree;
+}
+
+DiskBPTree* open_disk_bptree(BufferPoolManager* bpm, page_id_t meta_page_id) {
+    Page* meta_page = fetch_page(bpm, meta_page_id);
+    if (meta_page == NULL) return NULL;
+
+    DiskTreeMeta* meta = (DiskTreeMeta*)meta_page->data;
+    if (meta->magic != DISK_BPTREE_MAGIC) {
+        unpin_page(bpm, meta_page_id, false);
+        return NULL;
+    }
+
+    DiskBPTree* tree = (DiskBPTree*)malloc(sizeof(DiskBPTree));
+    tree->bpm = bpm;
+    tree->meta_page_id = meta_page_id;
+    tree->root_page_id = meta->root_page_id;
+    unpin_page(bpm, meta_page_id, false);
+    return tree;
+}
+
+void close_disk_bptree(DiskBPTree* tree) {
+    free(tree);
+}
+
+// 分配一个新页面并初始化为空节点，返回时页面处于钉住状态
+Page* new_disk_node(DiskBPTree* tree, page_id_t* page_id, bool is_leaf) {
+    Page* page = new_page(tree->bpm, page_id);
+    if (page == NULL) return NULL;
+    DiskNodeHeader* header = NODE_HEADER(page);
+    header->is_leaf = is_leaf;
+    header->num_keys = 0;
+    header->next = INVALID_PAGE_ID;
+    return page;
+}
+
+// 把根节点写进已经钉住的元数据页，并解除钉住
+static void write_disk_root(DiskBPTree* tree, Page* meta_page, page_id_t root_page_id) {
+    DiskTreeMeta* meta = (DiskTreeMeta*)meta_page->data;
+    meta->magic = DISK_BPTREE_MAGIC;
+    meta->root_page_id = root_page_id;
+    tree->root_page_id = root_page_id;
+    unpin_page(tree->bpm, tree->meta_page_id, true);
+}
+
+bool set_disk_root(DiskBPTree* tree, page_id_t root_page_id) {
+    Page* meta_page = fetch_page(tree->bpm, tree->meta_page_id);
+    if (meta_page == NULL) return false;
+    write_disk_root(tree, meta_page, root_page_id);
+    return true;
+}
+
+// --- 查找操作 ---
+
+// 与内存版 find_leaf 相同: 选择第一个大于 key 的键左边的指针
+int internal_child_index(Page* page, int key) {
+    int* keys = NODE_KEYS(page);
+    int lo = 0, hi = NODE_HEADER(page)->num_keys;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (key >= keys[mid]) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// 返回叶子中第一个 >= key 的位置
+static int leaf_lower_bound(Page* page, int key) {
+    int* keys = NODE_KEYS(page);
+    int lo = 0, hi = NODE_HEADER(page)->num_keys;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (keys[mid] < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// 从根走到叶子，沿途每层只钉住一个页面。path 非空时记录经过的内部节点，
+// 供分裂时向上回溯 (页面中不保存父指针，避免分裂时改写所有子页)
+static Page* find_disk_leaf(DiskBPTree* tree, int key, page_id_t* path, int* depth) {
+    page_id_t page_id = tree->root_page_id;
+    Page* page = fetch_page(tree->bpm, page_id);
+    if (depth) *depth = 0;
+    while (page != NULL && !NODE_HEADER(page)->is_leaf) {
+        if (path) path[(*depth)++] = page_id;
+        page_id_t child = INTERNAL_CHILDREN(page)[internal_child_index(page, key)];
+        unpin_page(tree->bpm, page_id, false);
+        page_id = child;
+        page = fetch_page(tree->bpm, page_id);
+    }
+    return page;
+}
+
+bool disk_bptree_search(DiskBPTree* tree, int key, disk_value_t* value) {
+    Page* leaf = find_disk_leaf(tree, key, NULL, NULL);
+    if (leaf == NULL) return false;
+
+    int i = leaf_lower_bound(leaf, key);
+    bool found = i < NODE_HEADER(leaf)->num_keys && NODE_KEYS(leaf)[i] == key;
+    if (found && value) {
+        *value = LEAF_VALUES(leaf)[i];
+    }
+    unpin_page(tree->bpm, leaf->page_id, false);
+    return found;
+}
+
+
+// --- 插入操作 ---
+
+// 分裂要用到的页面。叶子分裂会沿路径向上传播，中途拿不到页面时树已经改了一半
+// (叶子被截断，后一半只能从叶子链表访问到)，所以在修改任何节点之前把它们都准备好:
+// 钉住会被修改的祖先，分配新叶子、每个满的祖先分裂出的新节点，以及可能需要的新根
+typedef struct SplitPlan {
+    Page* ancestors[DISK_BPTREE_MAX_HEIGHT]; // ancestors[i] 是 path[i] 的页面，只有 [top, depth) 被钉住
+    int top;                    // 会被修改的最上层祖先
+    int depth;
+    Page* spares[DISK_BPTREE_MAX_HEIGHT + 2]; // 按使用顺序: 新叶子、各层新内部节点、新根
+    page_id_t spare_ids[DISK_BPTREE_MAX_HEIGHT + 2];
+    int num_spares;
+    int next_spare;
+    Page* meta;                 // 需要新根时钉住的元数据页
+} SplitPlan;
+
+static bool add_spare(DiskBPTree* tree, SplitPlan* plan, bool is_leaf) {
+    Page* page = new_disk_node(tree, &plan->spare_ids[plan->num_spares], is_leaf);
+    if (page == NULL) return false;
+    plan->spares[plan->num_spares++] = page;
+    return true;
+}
+
+static Page* take_spare(SplitPlan* plan, page_id_t* page_id) {
+    *page_id = plan->spare_ids[plan->next_spare];
+    return plan->spares[plan->next_spare++];
+}
+
+// 准备失败时放回已经拿到的页面，新分配的页面还给空闲空间映射
+static void release_split(DiskBPTree* tree, SplitPlan* plan) {
+    for (int i = plan->top; i < plan->depth; i++) {
+        unpin_page(tree->bpm, plan->ancestors[i]->page_id, false);
+    }
+    for (int i = 0; i < plan->num_spares; i++) {
+        unpin_page(tree->bpm, plan->spare_ids[i], false);
+        delete_page(tree->bpm, plan->spare_ids[i]);
+    }
+    if (plan->meta) unpin_page(tree->bpm, tree->meta_page_id, false);
+}
+
+static bool prepare_split(DiskBPTree* tree, page_id_t* path, int depth, SplitPlan* plan) {
+    plan->top = depth;
+    plan->depth = depth;
+    plan->num_spares = 0;
+    plan->next_spare = 0;
+    plan->meta = NULL;
+
+    if (!add_spare(tree, plan, true)) goto fail;
+    int level;
+    for (level = depth - 1; level >= 0; level--) {
+        Page* page = fetch_page(tree->bpm, path[level]);
+        if (page == NULL) goto fail;
+        plan->ancestors[level] = page;
+        plan->top = level;
+        if (NODE_HEADER(page)->num_keys < DISK_INTERNAL_MAX_KEYS) break;
+        if (!add_spare(tree, plan, false)) goto fail; // 满的祖先也要分裂
+    }
+    if (level < 0) {
+        // 分裂一直传到根 (或者叶子就是根)，树长高一层
+        if (!add_spare(tree, plan, false)) goto fail;
+        plan->meta = fetch_page(tree->bpm, tree->meta_page_id);
+        if (plan->meta == NULL) goto fail;
+    }
+    return true;
+
+fail:
+    release_split(tree, plan);
+    return false;
+}
+
+static void insert_into_disk_parent(DiskBPTree* tree, SplitPlan* plan, int depth,
+                                    page_id_t left_id, int key, page_id_t right_id);
+
+bool disk_bptree_insert(DiskBPTree* tree, int key, disk_value_t value) {
+    page_id_t path[DISK_BPTREE_MAX_HEIGHT];
+    int depth;
+    Page* leaf = find_disk_leaf(tree, key, path, &depth);
+    if (leaf == NULL) return false;
+
+    page_id_t leaf_id = leaf->page_id;
+    DiskNodeHeader* header = NODE_HEADER(leaf);
+    int* keys = NODE_KEYS(leaf);
+    disk_value_t* values = LEAF_VALUES(leaf);
+    int pos = leaf_lower_bound(leaf, key);
+    if (pos < header->num_keys && keys[pos] == key) {
+        unpin_page(tree->bpm, leaf_id, false);
+        return false;
+    }
+
+    if (header->num_keys < DISK_LEAF_MAX_KEYS) {
+        memmove(&keys[pos + 1], &keys[pos], (header->num_keys - pos) * sizeof(int));
+        memmove(&values[pos + 1], &values[pos], (header->num_keys - pos) * sizeof(disk_value_t));
+        keys[pos] = key;
+        values[pos] = value;
+        header->num_keys++;
+        unpin_page(tree->bpm, leaf_id, true);
+        return true;
+    }
+
+    // 叶子已满，分裂: 左边保留前一半，后一半移到新叶子。先准备好所有页面，之后的修改不会失败
+    SplitPlan plan;
+    if (!prepare_split(tree, path, depth, &plan)) {
+        unpin_page(tree->bpm, leaf_id, false);
+        return false;
+    }
+    page_id_t new_leaf_id;
+    Page* new_leaf = take_spare(&plan, &new_leaf_id);
+    DiskNodeHeader* new_header = NODE_HEADER(new_leaf);
+    int* new_keys = NODE_KEYS(new_leaf);
+    disk_value_t* new_values = LEAF_VALUES(new_leaf);
+
+    int total = DISK_LEAF_MAX_KEYS + 1;
+    int split = total / 2;
+    if (pos < split) {
+        // 新键落在左半边: 先把 [split - 1, max) 移走，再在左边插入
+        int moved = DISK_LEAF_MAX_KEYS - (split - 1);
+        memcpy(new_keys, &keys[split - 1], moved * sizeof(int));
+        memcpy(new_values, &values[split - 1], moved * sizeof(disk_value_t));
+        memmove(&keys[pos + 1], &keys[pos], (split - 1 - pos) * sizeof(int));
+        memmove(&values[pos + 1], &values[pos], (split - 1 - pos) * sizeof(disk_value_t));
+        keys[pos] = key;
+        values[pos] = value;
+        new_header->num_keys = moved;
+    } else {
+        int moved = DISK_LEAF_MAX_KEYS - split;
+        int new_pos = pos - split;
+        memcpy(new_keys, &keys[split], new_pos * sizeof(int));
+        memcpy(new_values, &values[split], new_pos * sizeof(disk_value_t));
+        new_keys[new_pos] = key;
+        new_values[new_pos] = value;
+        memcpy(&new_keys[new_pos + 1], &keys[pos], (moved - new_pos) * sizeof(int));
+        memcpy(&new_values[new_pos + 1], &values[pos], (moved - new_pos) * sizeof(disk_value_t));
+        new_header->num_keys = moved + 1;
+    }
+    header->num_keys = split;
+
+    new_header->next = header->next;
+    header->next = new_leaf_id;
+    int separator = new_keys[0];
+
+    unpin_page(tree->bpm, leaf_id, true);
+    unpin_page(tree->bpm, new_leaf_id, true);
+    insert_into_disk_parent(tree, &plan, depth, leaf_id, separator, new_leaf_id);
+    return true;
+}
+
+// 把 (key, right_id) 插入 left_id 的父节点，父节点是 plan->ancestors[depth - 1]。
+// 用到的页面都已由 prepare_split 准备好并钉住，这里只修改，用完后解除钉住
+static void insert_into_disk_parent(DiskBPTree* tree, SplitPlan* plan, int depth,
+                                    page_id_t left_id, int key, page_id_t right_id) {
+    if (depth == 0) {
+        // left 是根，生成新根，树长高一层
+        page_id_t root_id;
+        Page* root = take_spare(plan, &root_id);
+        NODE_HEADER(root)->num_keys = 1;
+        NODE_KEYS(root)[0] = key;
+        INTERNAL_CHILDREN(root)[0] = left_id;
+        INTERNAL_CHILDREN(root)[1] = right_id;
+        unpin_page(tree->bpm, root_id, true);
+        write_disk_root(tree, plan->meta, root_id);
+        return;
+    }
+
+    Page* parent = plan->ancestors[depth - 1];
+    page_id_t parent_id = parent->page_id;
+    DiskNodeHeader* header = NODE_HEADER(parent);
+    int* keys = NODE_KEYS(parent);
+    page_id_t* children = INTERNAL_CHILDREN(parent);
+
+    int left_index = 0;
+    while (left_index <= header->num_keys && children[left_index] != left_id) {
+        left_index++;
+    }
+
+    if (header->num_keys < DISK_INTERNAL_MAX_KEYS) {
+        int n = header->num_keys;
+        memmove(&keys[left_index + 1], &keys[left_index], (n - left_index) * sizeof(int));
+        memmove(&children[left_index + 2], &children[left_index + 1], (n - left_index) * sizeof(page_id_t));
+        keys[left_index] = key;
+        children[left_index + 1] = right_id;
+        header->num_keys++;
+        unpin_page(tree->bpm, parent_id, true);
+        return;
+    }
+
+    // 父节点已满，分裂内部节点并提升中间键
+    int temp_keys[DISK_INTERNAL_MAX_KEYS + 1];
+    page_id_t temp_children[DISK_INTERNAL_MAX_KEYS + 2];
+    int n = header->num_keys;
+    memcpy(temp_keys, keys, left_index * sizeof(int));
+    temp_keys[left_index] = key;
+    memcpy(&temp_keys[left_index + 1], &keys[left_index], (n - left_index) * sizeof(int));
+    memcpy(temp_children, children, (left_index + 1) * sizeof(page_id_t));
+    temp_children[left_index + 1] = right_id;
+    memcpy(&temp_children[left_index + 2], &children[left_index + 1], (n - left_index) * sizeof(page_id_t));
+
+    page_id_t new_id;
+    Page* new_node = take_spare(plan, &new_id);
+
+    int total = n + 1;
+    int split = total / 2;
+    int key_to_promote = temp_keys[split];
+
+    header->num_keys = split;
+    memcpy(keys, temp_keys, split * sizeof(int));
+    memcpy(children, temp_children, (split + 1) * sizeof(page_id_t));
+
+    int right_count = total - split - 1;
+    NODE_HEADER(new_node)->num_keys = right_count;
+    memcpy(NODE_KEYS(new_node), &temp_keys[split + 1], right_count * sizeof(int));
+    memcpy(INTERNAL_CHILDREN(new_node), &temp_children[split + 1], (right_count + 1) * sizeof(page_id_t));
+
+    unpin_page(tree->bpm, parent_id, true);
+    unpin_page(tree->bpm, new_id, true);
+    insert_into_disk_parent(tree, plan, depth - 1, parent_id, key_to_promote, new_id);
+}
@@ -0,0 +1,58 @@
+#ifndef DISK_BPTREE_H
+#define DISK_BPTREE_H
+
+#include "../storage/db_storage.h"
+
+// 磁盘版 B+ 树: 每个节点就是缓冲池中的一个页面 (PAGE_SIZE 字节)，
+// 子节点指针是 page_id_t，节点通过 fetch_page/unpin_page 按需换入换出，
+// 因此索引可以远大于内存。
+
+// 叶子中保存的值 (例如记录的 RID)
+typedef int64_t disk_value_t;
+
+#define DISK_BPTREE_MAGIC 0x42505431  // "BPT1"
+#define DISK_BPTREE_MAX_HEIGHT 32     // 插入时记录路径所用的栈深度
+
+// 页内节点头
+typedef struct DiskNodeHeader {
+    uint16_t is_leaf;
+    uint16_t num_keys;
+    page_id_t next;             // 叶子链表中的下一个叶子页 (内部节点不使用)
+} DiskNodeHeader;
+
+// 扇出由页面大小决定:
+// 叶子页:   [header][keys: int x N][values: disk_value_t x N]
+// 内部页:   [header][keys: int x N][children: page_id_t x (N + 1)]
+// N 取偶数，让 8 字节的值和子节点指针按 8 字节对齐
+#define DISK_LEAF_MAX_KEYS \
+    (((int)((PAGE_SIZE - sizeof(DiskNodeHeader)) / (sizeof(int) + sizeof(disk_value_t)))) & ~1)
+#define DISK_INTERNAL_MAX_KEYS \
+    (((int)((PAGE_SIZE - sizeof(DiskNodeHeader) - sizeof(page_id_t)) / (sizeof(int) + sizeof(page_id_t)))) & ~1)
+
+// 元数据页，记录根节点所在页，树通过它被重新打开
+typedef struct DiskTreeMeta {
+    uint32_t magic;
+    page_id_t root_page_id;
+} DiskTreeMeta;
+
+// 磁盘 B+ 树句柄 (本身只在内存中)
+typedef struct DiskBPTree {
+    BufferPoolManager* bpm;
+    page_id_t meta_page_id;
+    page_id_t root_page_id;
+} DiskBPTree;
+
+// --- 函数声明 ---
+
+// 创建、打开与关闭 (关闭只释放句柄，页面由缓冲池负责写回)
+DiskBPTree* create_disk_bptree(BufferPoolManager* bpm);
+DiskBPTree* open_disk_bptree(BufferPoolManager* bpm, page_id_t meta_page_id);
+void close_disk_bptree(DiskBPTree* tree);
+
+// 插入，键已存在或缓冲池无法提供页面时返回 false，此时树不变
+bool disk_bptree_insert(DiskBPTree* tree, int key, disk_value_t value);
+
+// 查找，找到时把值写入 *value 并返回 true
+bool disk_bptree_search(DiskBPTree* tree, int key, disk_value_t* value);
+
+#endif // DISK_BPTREE_H
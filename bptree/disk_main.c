@@ -0,0 +1,54 @@
+#include "disk_bptree.h"
+
+int main() {
+    const char* db_filename = "bptree_index.db";
+    remove(db_filename);
+
+    DiskManager* dm = create_disk_manager(db_filename);
+    BufferPoolManager* bpm = create_buffer_pool_manager(dm);
+    bpm->verbose = false; // 大量插入时关闭缓冲池日志
+
+    DiskBPTree* tree = create_disk_bptree(bpm);
+    printf("Disk B+Tree created: meta page %lld, leaf fan-out %d, internal fan-out %d.\n",
+           (long long)tree->meta_page_id, DISK_LEAF_MAX_KEYS, DISK_INTERNAL_MAX_KEYS + 1);
+
+    // 以乱序插入，触发叶子分裂和内部节点分裂；缓冲池只有 BUFFER_POOL_SIZE 个帧，
+    // 节点会在插入过程中不断被淘汰和重新读入
+    int n = 10000;
+    for (int i = 0; i < n; i++) {
+        int key = (int)(((long)i * 7919) % n);
+        if (!disk_bptree_insert(tree, key, (disk_value_t)key * 10)) {
+            printf("Insert of key %d failed.\n", key);
+        }
+    }
+    printf("Inserted %d keys, root is page %lld.\n", n, (long long)tree->root_page_id);
+
+    page_id_t meta_page_id = tree->meta_page_id;
+    close_disk_bptree(tree);
+    destroy_buffer_pool_manager(bpm);
+    destroy_disk_manager(dm);
+
+    // 重新打开数据库文件，验证树完整地保存在磁盘上
+    printf("\n--- Reopening %s ---\n", db_filename);
+    dm = create_disk_manager(db_filename);
+    bpm = create_buffer_pool_manager(dm);
+    bpm->verbose = false;
+    tree = open_disk_bptree(bpm, meta_page_id);
+
+    int missing = 0;
+    for (int key = 0; key < n; key++) {
+        disk_value_t value;
+        if (!disk_bptree_search(tree, key, &value) || value != (disk_value_t)key * 10) {
+            missing++;
+        }
+    }
+    printf("Searched %d keys after reopen, %d missing.\n", n, missing);
+
+    disk_value_t value;
+    printf("Key %d: %s\n", n + 1, disk_bptree_search(tree, n + 1, &value) ? "found" : "not found");
+
+    close_disk_bptree(tree);
+    destroy_buffer_pool_manager(bpm);
+    destroy_disk_manager(dm);
+    return 0;
+}
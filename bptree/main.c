@@ -52,10 +52,40 @@ int main() {
         printf("Key %d not found.\n", key_to_find);
     }
 
+    // 删除: 触发借键与合并，树可能变矮
+    printf("\n--- Removing 40, 50, 35, 30 ---\n");
+    remove_key(tree, 40);
+    remove_key(tree, 50);
+    remove_key(tree, 35);
+    remove_key(tree, 30);
+    print_tree(tree);
+
+    // 范围扫描
+    printf("\n--- Range scan [12, 36] ---\n");
+    BPTreeCursor cursor;
+    open_cursor(tree, &cursor, 12, 36);
+    int scan_key;
+    void* scan_value;
+    while (cursor_next(&cursor, &scan_key, &scan_value)) {
+        printf("  %d -> %ld\n", scan_key, (long)scan_value);
+    }
+
     // 销毁树，释放内存
     destroy_tree(tree);
     printf("\nTree destroyed.\n");
 
+    // 批量构建: 直接从有序数组自底向上生成整棵树
+    printf("\n--- Bulk loading 20 sorted keys (fill factor 1.0) ---\n");
+    int keys[20];
+    void* values[20];
+    for (int i = 0; i < 20; i++) {
+        keys[i] = (i + 1) * 5;
+        values[i] = (void*)(long)(keys[i] * 10);
+    }
+    tree = bulk_load_bptree(order, keys, values, 20, 1.0);
+    print_tree(tree);
+    destroy_tree(tree);
+
     return 0;
 }
 
@@ -0,0 +1,344 @@
+#include "str_bptree.h"
+
+#define NODE_BYTES(node) ((uint8_t*)(node))
+#define NODE_PREFIX(node) (NODE_BYTES(node) + (node)->prefix_offset)
+#define SLOT_SUFFIX(node, i) (NODE_BYTES(node) + (node)->slots[i].offset)
+#define SLOTS_END(n) (sizeof(StrNode) + (size_t)(n) * sizeof(StrSlot))
+
+// --- 内部辅助函数声明 ---
+StrNode* create_str_node(StrBPTree* tree, bool is_leaf);
+void destroy_str_node(StrNode* node);
+bool insert_into_str_parent(StrBPTree* tree, StrNode** path, int* child_index, int depth,
+                            const uint8_t* separator, int separator_len, StrNode* right);
+
+// --- 字节串比较 ---
+
+static int compare_bytes(const uint8_t* a, size_t alen, const uint8_t* b, size_t blen) {
+    size_t n = alen < blen ? alen : blen;
+    int c = memcmp(a, b, n);
+    if (c != 0) return c;
+    return (alen > blen) - (alen < blen);
+}
+
+static size_t common_prefix(const uint8_t* a, size_t alen, const uint8_t* b, size_t blen) {
+    size_t n = alen < blen ? alen : blen;
+    size_t i = 0;
+    while (i < n && a[i] == b[i]) i++;
+    return i;
+}
+
+// 节点中比 key 小 (upper 为 true 时为小于等于) 的键的个数。
+// 先和公共前缀比较一次，只有 key 带有同样的前缀时才在后缀上二分
+static int node_position(StrNode* node, const uint8_t* key, size_t len, bool upper) {
+    size_t plen = node->prefix_len;
+    int c = memcmp(key, NODE_PREFIX(node), len < plen ? len : plen);
+    if (c < 0 || (c == 0 && len < plen)) return 0;
+    if (c > 0) return node->num_keys;
+
+    const uint8_t* rest = key + plen;
+    size_t rest_len = len - plen;
+    int lo = 0, hi = node->num_keys;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        int cmp = compare_bytes(SLOT_SUFFIX(node, mid), node->slots[mid].length, rest, rest_len);
+        if (cmp < 0 || (upper && cmp == 0)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static bool node_key_equals(StrNode* node, int i, const uint8_t* key, size_t len) {
+    size_t plen = node->prefix_len;
+    return len == plen + node->slots[i].length
+        && memcmp(key, NODE_PREFIX(node), plen) == 0
+        && memcmp(key + plen, SLOT_SUFFIX(node, i), len - plen) == 0;
+}
+
+static StrNode* child_at(StrNode* node, int i) {
+    return i == 0 ? node->leftmost : (StrNode*)node->slots[i - 1].pointer;
+}
+
+// --- 创建与销毁 ---
+
+StrBPTree* create_str_bptree(void) {
+    StrBPTree* tree = (StrBPTree*)malloc(sizeof(StrBPTree));
+    tree->node_count = 0;
+    // 解压一个节点再加一个新条目，最多 STR_MAX_SLOTS + 1 个完整键
+    tree->scratch_entries = (StrEntry*)malloc((STR_MAX_SLOTS + 1) * sizeof(StrEntry));
+    tree->scratch_bytes = (uint8_t*)malloc((size_t)(STR_MAX_SLOTS + 1) * STR_MAX_KEY_LEN);
+    tree->root = create_str_node(tree, true);
+    return tree;
+}
+
+StrNode* create_str_node(StrBPTree* tree, bool is_leaf) {
+    StrNode* node = (StrNode*)aligned_alloc(64, STR_NODE_SIZE);
+    node->is_leaf = is_leaf;
+    node->num_keys = 0;
+    node->prefix_offset = STR_NODE_SIZE;
+    node->prefix_len = 0;
+    node->heap_top = STR_NODE_SIZE;
+    node->next = NULL;
+    node->leftmost = NULL;
+    tree->node_count++;
+    return node;
+}
+
+void destroy_str_node(StrNode* node) {
+    if (!node->is_leaf) {
+        for (int i = 0; i <= node->num_keys; i++) {
+            destroy_str_node(child_at(node, i));
+        }
+    }
+    free(node);
+}
+
+void destroy_str_bptree(StrBPTree* tree) {
+    destroy_str_node(tree->root);
+    free(tree->scratch_entries);
+    free(tree->scratch_bytes);
+    free(tree);
+}
+
+// --- 节点编码与解码 ---
+
+// 把节点解压成完整键列表，放在树的临时区中
+static int decode_node(StrBPTree* tree, StrNode* node) {
+    uint8_t* out = tree->scratch_bytes;
+    for (int i = 0; i < node->num_keys; i++) {
+        StrEntry* e = &tree->scratch_entries[i];
+        memcpy(out, NODE_PREFIX(node), node->prefix_len);
+        memcpy(out + node->prefix_len, SLOT_SUFFIX(node, i), node->slots[i].length);
+        e->key = out;
+        e->len = node->prefix_len + node->slots[i].length;
+        e->pointer = node->slots[i].pointer;
+        out += e->len;
+    }
+    return node->num_keys;
+}
+
+// 有序键的公共前缀就是首尾两个键的公共前缀
+static size_t entries_prefix(const StrEntry* entries, int n) {
+    if (n == 0) return 0;
+    return common_prefix(entries[0].key, entries[0].len, entries[n - 1].key, entries[n - 1].len);
+}
+
+// 压缩后需要的字节数
+static size_t encoded_size(const StrEntry* entries, int n) {
+    size_t plen = entries_prefix(entries, n);
+    size_t size = SLOTS_END(n) + plen;
+    for (int i = 0; i < n; i++) size += entries[i].len - plen;
+    return size;
+}
+
+// 把完整键列表压缩写入节点 (保留 is_leaf/next/leftmost)，调用前需确认放得下
+static void encode_node(StrNode* node, const StrEntry* entries, int n) {
+    size_t plen = entries_prefix(entries, n);
+    uint16_t top = STR_NODE_SIZE;
+
+    top -= plen;
+    if (n > 0) memcpy(NODE_BYTES(node) + top, entries[0].key, plen);
+    node->prefix_offset = top;
+    node->prefix_len = plen;
+
+    for (int i = 0; i < n; i++) {
+        uint16_t suffix_len = entries[i].len - plen;
+        top -= suffix_len;
+        memcpy(NODE_BYTES(node) + top, entries[i].key + plen, suffix_len);
+        node->slots[i].offset = top;
+        node->slots[i].length = suffix_len;
+        node->slots[i].pointer = entries[i].pointer;
+    }
+    node->num_keys = n;
+    node->heap_top = top;
+}
+
+// 快速路径: 新键带有节点当前的公共前缀且剩余空间足够时，直接追加后缀，不重建节点
+static bool insert_in_place(StrNode* node, int pos, const uint8_t* key, size_t len, void* pointer) {
+    size_t plen = node->prefix_len;
+    if (node->num_keys == 0 || len < plen || memcmp(key, NODE_PREFIX(node), plen) != 0) {
+        return false;
+    }
+    size_t suffix_len = len - plen;
+    if (SLOTS_END(node->num_keys + 1) + suffix_len > node->heap_top) {
+        return false;
+    }
+    node->heap_top -= suffix_len;
+    memcpy(NODE_BYTES(node) + node->heap_top, key + plen, suffix_len);
+    memmove(&node->slots[pos + 1], &node->slots[pos], (node->num_keys - pos) * sizeof(StrSlot));
+    node->slots[pos].offset = node->heap_top;
+    node->slots[pos].length = suffix_len;
+    node->slots[pos].pointer = pointer;
+    node->num_keys++;
+    return true;
+}
+
+// 分裂后右半部分 (内部节点跳过被提升的第 m 个键) 压缩后的字节数
+static size_t right_size(const StrEntry* entries, int n, int m, bool skip_middle) {
+    int start = skip_middle ? m + 1 : m;
+    return encoded_size(entries + start, n - start);
+}
+
+// 选择分裂点 m: 左边是前 m 个键，按压缩后的字节数尽量平分，并保证两边都放得下。
+// 左边大小随 m 单调增、右边单调减，先二分找平衡点再向可行区间调整。
+// 内部节点 (skip_middle) 的第 m 个键会被提升，不留在任何一边
+static int choose_split(const StrEntry* entries, int n, bool skip_middle) {
+    int lo = 1, hi = n - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (encoded_size(entries, mid) < right_size(entries, n, mid, skip_middle)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    int m = lo;
+    while (m > 1 && encoded_size(entries, m) > STR_NODE_SIZE) m--;
+    while (m < n - 1 && right_size(entries, n, m, skip_middle) > STR_NODE_SIZE) m++;
+    return m;
+}
+
+// --- 查找操作 ---
+
+void* str_bptree_search(StrBPTree* tree, const void* key, size_t len) {
+    const uint8_t* k = (const uint8_t*)key;
+    StrNode* node = tree->root;
+    while (!node->is_leaf) {
+        node = child_at(node, node_position(node, k, len, true));
+    }
+    int i = node_position(node, k, len, false);
+    if (i < node->num_keys && node_key_equals(node, i, k, len)) {
+        return node->slots[i].pointer;
+    }
+    return NULL;
+}
+
+// --- 插入操作 ---
+
+bool str_bptree_insert(StrBPTree* tree, const void* key, size_t len, void* value) {
+    const uint8_t* k = (const uint8_t*)key;
+    if (len > STR_MAX_KEY_LEN) return false;
+
+    // 下降时记录路径，分裂沿路径向上处理
+    StrNode* path[STR_MAX_HEIGHT];
+    int child_index[STR_MAX_HEIGHT];
+    int depth = 0;
+    StrNode* leaf = tree->root;
+    while (!leaf->is_leaf) {
+        int i = node_position(leaf, k, len, true);
+        path[depth] = leaf;
+        child_index[depth++] = i;
+        leaf = child_at(leaf, i);
+    }
+
+    int pos = node_position(leaf, k, len, false);
+    if (pos < leaf->num_keys && node_key_equals(leaf, pos, k, len)) {
+        return false;
+    }
+    if (insert_in_place(leaf, pos, k, len, value)) {
+        return true;
+    }
+
+    // 重建: 解压、插入、重新压缩 (公共前缀可能变短)，放不下再分裂
+    int n = decode_node(tree, leaf);
+    StrEntry* entries = tree->scratch_entries;
+    memmove(&entries[pos + 1], &entries[pos], (n - pos) * sizeof(StrEntry));
+    entries[pos].key = k;
+    entries[pos].len = len;
+    entries[pos].pointer = value;
+    n++;
+    if (encoded_size(entries, n) <= STR_NODE_SIZE) {
+        encode_node(leaf, entries, n);
+        return true;
+    }
+
+    int m = choose_split(entries, n, false);
+    StrNode* right = create_str_node(tree, true);
+    right->next = leaf->next;
+    leaf->next = right;
+
+    // 后缀截断: 分隔键取右边第一个键中刚好能与左边最后一个键区分开的最短前缀
+    uint8_t separator[STR_MAX_KEY_LEN];
+    const StrEntry* last_left = &entries[m - 1];
+    const StrEntry* first_right = &entries[m];
+    int separator_len = common_prefix(last_left->key, last_left->len, first_right->key, first_right->len) + 1;
+    memcpy(separator, first_right->key, separator_len);
+
+    encode_node(right, entries + m, n - m);
+    encode_node(leaf, entries, m);
+    return insert_into_str_parent(tree, path, child_index, depth, separator, separator_len, right);
+}
+
+// 把 (separator, right) 插入 path[depth - 1]，right 成为其第 child_index[depth - 1] + 1 个孩子
+bool insert_into_str_parent(StrBPTree* tree, StrNode** path, int* child_index, int depth,
+                            const uint8_t* separator, int separator_len, StrNode* right) {
+    if (depth == 0) {
+        StrNode* old_root = tree->root;
+        StrNode* root = create_str_node(tree, false);
+        StrEntry entry = { separator, (uint16_t)separator_len, right };
+        root->leftmost = old_root;
+        encode_node(root, &entry, 1);
+        tree->root = root;
+        return true;
+    }
+
+    StrNode* node = path[depth - 1];
+    int pos = child_index[depth - 1];
+    if (insert_in_place(node, pos, separator, separator_len, right)) {
+        return true;
+    }
+
+    int n = decode_node(tree, node);
+    StrEntry* entries = tree->scratch_entries;
+    memmove(&entries[pos + 1], &entries[pos], (n - pos) * sizeof(StrEntry));
+    entries[pos].key = separator;
+    entries[pos].len = separator_len;
+    entries[pos].pointer = right;
+    n++;
+    if (encoded_size(entries, n) <= STR_NODE_SIZE) {
+        encode_node(node, entries, n);
+        return true;
+    }
+
+    // 内部节点分裂: 中间的分隔键上移，它的右孩子成为新节点的最左孩子
+    int m = choose_split(entries, n, true);
+    StrNode* new_node = create_str_node(tree, false);
+    new_node->leftmost = (StrNode*)entries[m].pointer;
+
+    uint8_t promoted[STR_MAX_KEY_LEN];
+    int promoted_len = entries[m].len;
+    memcpy(promoted, entries[m].key, promoted_len);
+
+    encode_node(new_node, entries + m + 1, n - m - 1);
+    encode_node(node, entries, m);
+    return insert_into_str_parent(tree, path, child_index, depth - 1, promoted, promoted_len, new_node);
+}
+
+// --- 统计 ---
+
+static void collect_str_stats(StrNode* node, int level, StrTreeStats* stats) {
+    if (level + 1 > stats->height) stats->height = level + 1;
+    stats->node_count++;
+    stats->stored_key_bytes += node->prefix_len;
+    for (int i = 0; i < node->num_keys; i++) {
+        stats->stored_key_bytes += node->slots[i].length;
+    }
+    if (node->is_leaf) {
+        stats->num_keys += node->num_keys;
+        for (int i = 0; i < node->num_keys; i++) {
+            stats->logical_key_bytes += node->prefix_len + node->slots[i].length;
+        }
+        return;
+    }
+    for (int i = 0; i <= node->num_keys; i++) {
+        collect_str_stats(child_at(node, i), level + 1, stats);
+    }
+}
+
+void get_str_tree_stats(StrBPTree* tree, StrTreeStats* stats) {
+    memset(stats, 0, sizeof(StrTreeStats));
+    collect_str_stats(tree->root, 0, stats);
+    stats->bytes = stats->node_count * STR_NODE_SIZE;
+}
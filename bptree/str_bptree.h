@@ -0,0 +1,83 @@
+#ifndef STR_BPTREE_H
+#define STR_BPTREE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// 变长键 (字符串/二进制) B+ 树。
+// 每个节点是固定大小的字节块，扇出由键的实际字节数决定而不是固定的阶:
+// - 节点头记录本节点所有键的公共前缀，只存一次，每个键只存前缀之后的后缀；
+// - 叶子分裂时提升到父节点的分隔键被截断为能区分左右两边的最短前缀。
+// URL、路径、组合键这类前缀很长的键，单个节点能放下更多键，树更矮、占用更小。
+//
+// 没有把变长键做进 bptree.h 的 BPTree: 那里的节点按阶预留定长的 int 键数组，
+// 节点内查找用 SIMD 比较 int，乐观并发、批量加载、磁盘 B+ 树和基准测试也都按 int 键调用。
+// 变长键要按字节数管理节点空间，改动会波及所有这些调用者，所以单独实现，int 键的树保持不变。
+
+#define STR_NODE_SIZE 4096          // 每个节点的字节数
+#define STR_MAX_KEY_LEN 1024        // 单个键的最大长度，保证一个节点至少能放下几个键
+#define STR_MAX_HEIGHT 32
+
+// 槽位: 指向块内堆区中的键后缀。叶子中 pointer 是值，
+// 内部节点中第 i 个槽位的 pointer 是第 i + 1 个孩子 (第 0 个孩子在 leftmost)
+typedef struct StrSlot {
+    void* pointer;
+    uint16_t offset;            // 后缀在节点块内的偏移
+    uint16_t length;            // 后缀长度
+} StrSlot;
+
+// 节点块布局: [StrNode 头][slots ...] ... 空闲 ... [堆区: 前缀和各个后缀，从块尾向前增长]
+typedef struct StrNode {
+    bool is_leaf;
+    uint16_t num_keys;
+    uint16_t prefix_offset;     // 公共前缀在块内的偏移
+    uint16_t prefix_len;        // 公共前缀长度
+    uint16_t heap_top;          // 堆区起始偏移，之前的空间可用于新槽位
+    struct StrNode* next;       // 叶子链表
+    struct StrNode* leftmost;   // 内部节点的第 0 个孩子
+    StrSlot slots[];
+} StrNode;
+
+#define STR_MAX_SLOTS ((int)((STR_NODE_SIZE - sizeof(StrNode)) / sizeof(StrSlot)))
+
+// 节点解压后的完整键，只在修改节点时临时使用
+typedef struct StrEntry {
+    const uint8_t* key;
+    uint16_t len;
+    void* pointer;
+} StrEntry;
+
+typedef struct StrBPTree {
+    StrNode* root;
+    size_t node_count;
+    StrEntry* scratch_entries;  // 重建节点用的临时区，随树分配一次
+    uint8_t* scratch_bytes;
+} StrBPTree;
+
+// 统计信息
+typedef struct StrTreeStats {
+    int height;
+    size_t node_count;
+    size_t bytes;               // 节点占用的总字节数
+    size_t num_keys;            // 叶子中的键数
+    size_t logical_key_bytes;   // 叶子中所有键的原始总长度
+    size_t stored_key_bytes;    // 实际存储的键字节数 (前缀 + 后缀，含内部节点的分隔键)
+} StrTreeStats;
+
+// --- 函数声明 ---
+
+StrBPTree* create_str_bptree(void);
+void destroy_str_bptree(StrBPTree* tree);
+
+// 插入，键已存在或超过 STR_MAX_KEY_LEN 时返回 false
+bool str_bptree_insert(StrBPTree* tree, const void* key, size_t len, void* value);
+
+// 查找，不存在时返回 NULL
+void* str_bptree_search(StrBPTree* tree, const void* key, size_t len);
+
+void get_str_tree_stats(StrBPTree* tree, StrTreeStats* stats);
+
+#endif // STR_BPTREE_H
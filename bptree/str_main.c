@@ -0,0 +1,35 @@
+#include "str_bptree.h"
+
+int main() {
+    StrBPTree* tree = create_str_bptree();
+
+    // URL 风格的键: 同一节点内的键通常共享很长的前缀
+    char key[256];
+    int n = 100000;
+    for (int i = 0; i < n; i++) {
+        int len = snprintf(key, sizeof(key), "https://example.com/api/v1/users/%06d/orders/%04d",
+                           (i * 7919) % n, i % 37);
+        str_bptree_insert(tree, key, len, (void*)(long)(i + 1));
+    }
+
+    int found = 0;
+    for (int i = 0; i < n; i++) {
+        int len = snprintf(key, sizeof(key), "https://example.com/api/v1/users/%06d/orders/%04d",
+                           (i * 7919) % n, i % 37);
+        if (str_bptree_search(tree, key, len) == (void*)(long)(i + 1)) found++;
+    }
+    printf("Inserted %d URL keys, found %d.\n", n, found);
+
+    const char* missing = "https://example.com/api/v1/users/";
+    printf("Search \"%s\": %s\n", missing,
+           str_bptree_search(tree, missing, strlen(missing)) ? "found" : "not found");
+
+    StrTreeStats stats;
+    get_str_tree_stats(tree, &stats);
+    printf("Height: %d, nodes: %zu, node bytes: %zu\n", stats.height, stats.node_count, stats.bytes);
+    printf("Key bytes: %zu logical, %zu stored (%.1f%%)\n", stats.logical_key_bytes,
+           stats.stored_key_bytes, 100.0 * stats.stored_key_bytes / stats.logical_key_bytes);
+
+    destroy_str_bptree(tree);
+    return 0;
+}
@@ -0,0 +1,33 @@
+#include "bptree.hpp"
+#include <cstdint>
+#include <cstdio>
+
+// 小的定长结构体可以直接作为值内联存放在叶子中
+struct AccountRef {
+    int32_t shard;
+    int32_t slot;
+};
+
+int main() {
+    // 64 位 ID 作键，每个节点最多 128 个键，节点大小在编译期确定
+    dblab::BPTree<uint64_t, AccountRef, 128> tree;
+
+    for (uint64_t i = 0; i < 100000; i++) {
+        uint64_t id = (i * 2654435761ULL) % 1000003ULL;
+        tree.insert(id, AccountRef{(int32_t)(id % 16), (int32_t)i});
+    }
+    printf("Inserted %zu ids, tree height %d.\n", tree.size(), tree.height());
+
+    const AccountRef* ref = tree.find(2654435761ULL % 1000003ULL);
+    if (ref) {
+        printf("Found id -> shard %d, slot %d\n", ref->shard, ref->slot);
+    }
+
+    printf("First ids >= 500000:");
+    int shown = 0;
+    for (auto it = tree.lower_bound(500000); it != tree.end() && shown < 5; ++it, ++shown) {
+        printf(" %llu", (unsigned long long)it.key());
+    }
+    printf("\n");
+    return 0;
+}
@@ -0,0 +1,261 @@
+#include "async_io.h"
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#if defined(__linux__) && defined(__NR_io_uring_setup) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define HAVE_IO_URING 1
+#else
+#define HAVE_IO_URING 0
+#endif
+
+// 读到文件末尾之后的部分补零，和 read_page_from_disk 的行为一致
+static void complete_request(PageIORequest* request, int result, int page_size) {
+    if (!request->is_write && result >= 0 && result < page_size) {
+        memset(request->data + result, 0, page_size - result);
+    }
+    if (request->is_write && result >= 0 && result != page_size) {
+        result = -EIO;
+    }
+    request->result = result;
+    request->done = true;
+}
+
+
+// --- 同步后端 ---
+
+static int sync_submit(AsyncIO* aio, PageIORequest* requests, int n) {
+    for (int i = 0; i < n; i++) {
+        PageIORequest* request = &requests[i];
+        off_t offset;
+        int fd = disk_manager_locate(aio->disk_manager, request->page_id, &offset);
+        ssize_t result = request->is_write
+            ? pwrite(fd, request->data, aio->disk_manager->page_size, offset)
+            : pread(fd, request->data, aio->disk_manager->page_size, offset);
+        complete_request(request, result < 0 ? -errno : (int)result, aio->disk_manager->page_size);
+    }
+    aio->completed_sync += n;
+    return n;
+}
+
+
+// --- io_uring 后端 ---
+// 不依赖 liburing，直接使用系统调用和共享内存中的提交/完成队列
+
+#if HAVE_IO_URING
+
+static int io_uring_setup(unsigned entries, struct io_uring_params* params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static bool uring_init(AsyncIO* aio) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = io_uring_setup((unsigned)aio->queue_depth, &params);
+    if (fd < 0) return false;
+
+    aio->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    aio->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap && aio->cq_ring_size > aio->sq_ring_size) {
+        aio->sq_ring_size = aio->cq_ring_size;
+    }
+
+    aio->sq_ring = mmap(NULL, aio->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        fd, IORING_OFF_SQ_RING);
+    if (aio->sq_ring == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    if (single_mmap) {
+        aio->cq_ring = aio->sq_ring;
+    } else {
+        aio->cq_ring = mmap(NULL, aio->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            fd, IORING_OFF_CQ_RING);
+        if (aio->cq_ring == MAP_FAILED) {
+            munmap(aio->sq_ring, aio->sq_ring_size);
+            close(fd);
+            return false;
+        }
+    }
+    aio->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    aio->sqes = mmap(NULL, aio->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     fd, IORING_OFF_SQES);
+    if (aio->sqes == MAP_FAILED) {
+        if (!single_mmap) munmap(aio->cq_ring, aio->cq_ring_size);
+        munmap(aio->sq_ring, aio->sq_ring_size);
+        close(fd);
+        return false;
+    }
+
+    char* sq = (char*)aio->sq_ring;
+    char* cq = (char*)aio->cq_ring;
+    aio->sq_head = (unsigned*)(sq + params.sq_off.head);
+    aio->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    aio->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+    aio->sq_array = (unsigned*)(sq + params.sq_off.array);
+    aio->cq_head = (unsigned*)(cq + params.cq_off.head);
+    aio->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    aio->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+    aio->cqes = cq + params.cq_off.cqes;
+    aio->ring_fd = fd;
+    return true;
+}
+
+static void uring_destroy(AsyncIO* aio) {
+    munmap(aio->sqes, aio->sqes_size);
+    if (aio->cq_ring != aio->sq_ring) munmap(aio->cq_ring, aio->cq_ring_size);
+    munmap(aio->sq_ring, aio->sq_ring_size);
+    close(aio->ring_fd);
+}
+
+// 把提交队列中还没被内核取走的请求交给内核，同时可以等待 min_complete 个完成
+static int uring_enter(AsyncIO* aio, unsigned min_complete) {
+    unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+    int ret;
+    do {
+        ret = io_uring_enter(aio->ring_fd, aio->sq_unsubmitted, min_complete, flags);
+    } while (ret < 0 && errno == EINTR);
+    if (ret < 0) {
+        perror("io_uring_enter 失败");
+        return -1;
+    }
+    aio->sq_unsubmitted -= ret;
+    return ret;
+}
+
+static int uring_submit(AsyncIO* aio, PageIORequest* requests, int n) {
+    unsigned tail = *aio->sq_tail;
+    struct io_uring_sqe* sqes = (struct io_uring_sqe*)aio->sqes;
+    for (int i = 0; i < n; i++) {
+        PageIORequest* request = &requests[i];
+        off_t offset;
+        int fd = disk_manager_locate(aio->disk_manager, request->page_id, &offset);
+        request->iov.iov_base = request->data;
+        request->iov.iov_len = aio->disk_manager->page_size;
+
+        unsigned index = tail & *aio->sq_mask;
+        struct io_uring_sqe* sqe = &sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = request->is_write ? IORING_OP_WRITEV : IORING_OP_READV;
+        sqe->fd = fd;
+        sqe->off = (uint64_t)offset;
+        sqe->addr = (uint64_t)(uintptr_t)&request->iov;
+        sqe->len = 1;
+        sqe->user_data = (uint64_t)(uintptr_t)request;
+        aio->sq_array[index] = index;
+        tail++;
+    }
+    // 内核读到新的 tail 之前，队列项必须已经写好
+    __atomic_store_n(aio->sq_tail, tail, __ATOMIC_RELEASE);
+    aio->sq_unsubmitted += n;
+    uring_enter(aio, 0);
+    return n;
+}
+
+static int uring_reap(AsyncIO* aio, int min_complete) {
+    int reaped = 0;
+    for (;;) {
+        unsigned head = *aio->cq_head;
+        unsigned tail = __atomic_load_n(aio->cq_tail, __ATOMIC_ACQUIRE);
+        struct io_uring_cqe* cqes = (struct io_uring_cqe*)aio->cqes;
+        for (; head != tail; head++) {
+            struct io_uring_cqe* cqe = &cqes[head & *aio->cq_mask];
+            complete_request((PageIORequest*)(uintptr_t)cqe->user_data, cqe->res, aio->disk_manager->page_size);
+            aio->in_flight--;
+            reaped++;
+        }
+        __atomic_store_n(aio->cq_head, head, __ATOMIC_RELEASE);
+
+        if (reaped >= min_complete) {
+            if (aio->sq_unsubmitted > 0) uring_enter(aio, 0);
+            return reaped;
+        }
+        if (uring_enter(aio, (unsigned)(min_complete - reaped)) < 0) return reaped;
+    }
+}
+
+#endif // HAVE_IO_URING
+
+
+// --- 公共接口 ---
+
+AsyncIO* create_async_io(DiskManager* disk_manager, int queue_depth, bool use_io_uring) {
+    AsyncIO* aio = (AsyncIO*)calloc(1, sizeof(AsyncIO));
+    aio->disk_manager = disk_manager;
+    aio->queue_depth = queue_depth > 0 ? queue_depth : 1;
+    aio->backend = ASYNC_IO_SYNC;
+    aio->ring_fd = -1;
+#if HAVE_IO_URING
+    if (use_io_uring && uring_init(aio)) {
+        aio->backend = ASYNC_IO_URING;
+    }
+#else
+    (void)use_io_uring;
+#endif
+    return aio;
+}
+
+void destroy_async_io(AsyncIO* aio) {
+    if (!aio) return;
+#if HAVE_IO_URING
+    if (aio->backend == ASYNC_IO_URING) {
+        // 在途的请求引用调用者的缓冲区，必须等它们完成
+        while (aio->in_flight > 0 && uring_reap(aio, aio->in_flight) > 0) {}
+        uring_destroy(aio);
+    }
+#endif
+    free(aio);
+}
+
+int async_io_submit(AsyncIO* aio, PageIORequest* requests, int n) {
+    int room = aio->queue_depth - aio->in_flight;
+    if (n > room) n = room;
+    if (n <= 0) return 0;
+    for (int i = 0; i < n; i++) {
+        requests[i].done = false;
+    }
+    aio->in_flight += n;
+#if HAVE_IO_URING
+    if (aio->backend == ASYNC_IO_URING) {
+        return uring_submit(aio, requests, n);
+    }
+#endif
+    return sync_submit(aio, requests, n);
+}
+
+int async_io_reap(AsyncIO* aio, int min_complete) {
+    if (min_complete > aio->in_flight) min_complete = aio->in_flight;
+#if HAVE_IO_URING
+    if (aio->backend == ASYNC_IO_URING) {
+        return uring_reap(aio, min_complete);
+    }
+#endif
+    int reaped = aio->completed_sync;
+    aio->completed_sync = 0;
+    aio->in_flight -= reaped;
+    return reaped;
+}
+
+int async_io_run(AsyncIO* aio, PageIORequest* requests, int n) {
+    int submitted = 0;
+    while (submitted < n) {
+        int count = async_io_submit(aio, requests + submitted, n - submitted);
+        submitted += count;
+        // 队列满了，先收割一部分再继续提交
+        if (count == 0 && async_io_reap(aio, 1) == 0) break;
+    }
+    while (aio->in_flight > 0) {
+        if (async_io_reap(aio, aio->in_flight) == 0) break;
+    }
+
+    int failed = 0;
+    for (int i = 0; i < n; i++) {
+        if (!requests[i].done || requests[i].result < 0) failed++;
+    }
+    return failed;
+}
@@ -0,0 +1,66 @@
+#ifndef ASYNC_IO_H
+#define ASYNC_IO_H
+
+#include <sys/uio.h>
+#include "db_storage.h"
+
+// 异步批量页面 I/O。优先使用 io_uring: 一次 io_uring_enter 提交一批读写，
+// 调用者可以在 I/O 进行时做别的事，之后再收割完成的请求。
+// 内核不支持 io_uring (或被禁用) 时退化为逐个 pread/pwrite，接口不变。
+// 一个 AsyncIO 只能由一个线程使用；多个线程各自创建，底层文件描述符可以共享
+
+typedef enum AsyncIOBackend {
+    ASYNC_IO_SYNC,              // pread/pwrite，提交时就完成
+    ASYNC_IO_URING
+} AsyncIOBackend;
+
+// 一个页面读写请求。请求在完成前必须保持有效 (io_uring 直接引用其中的 iovec)
+typedef struct PageIORequest {
+    page_id_t page_id;
+    char* data;                 // 一个页面大小 (disk_manager->page_size) 的缓冲区
+    bool is_write;
+    bool done;
+    int result;                 // 完成后: 传输的字节数，或负的 errno
+    struct iovec iov;           // 内部使用
+} PageIORequest;
+
+typedef struct AsyncIO {
+    DiskManager* disk_manager;
+    AsyncIOBackend backend;
+    int queue_depth;            // 同时在途的请求数上限
+    int in_flight;
+    int completed_sync;         // 同步后端: 已完成但还没被收割的请求数
+
+    // io_uring 状态 (backend == ASYNC_IO_URING 时有效)
+    int ring_fd;
+    unsigned sq_unsubmitted;    // 已放入提交队列、还没被内核取走的请求数
+    void* sq_ring;
+    size_t sq_ring_size;
+    void* cq_ring;
+    size_t cq_ring_size;
+    void* sqes;
+    size_t sqes_size;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    void* cqes;
+} AsyncIO;
+
+// use_io_uring 为 false 时直接使用同步后端
+AsyncIO* create_async_io(DiskManager* disk_manager, int queue_depth, bool use_io_uring);
+void destroy_async_io(AsyncIO* aio);
+
+// 提交最多 n 个请求，受队列深度限制，返回实际提交的个数 (不阻塞等待完成)
+int async_io_submit(AsyncIO* aio, PageIORequest* requests, int n);
+
+// 收割已完成的请求 (设置其 done 和 result)，至少等到 min_complete 个完成，返回收割的个数
+int async_io_reap(AsyncIO* aio, int min_complete);
+
+// 提交全部请求并等待全部完成，返回失败的请求个数
+int async_io_run(AsyncIO* aio, PageIORequest* requests, int n);
+
+#endif // ASYNC_IO_H
@@ -1,236 +1,1637 @@
+#define _GNU_SOURCE                 // fallocate, O_DIRECT, MAP_HUGETLB
 #include "db_storage.h"
+#include "replacer.h"
+#include "async_io.h"
+#include "wal.h"
+#include "recovery.h"
 
-// --- 内部辅助函数 (LRU Replacer) ---
-void lru_replacer_pin(BufferPoolManager* bpm, int frame_id);
-void lru_replacer_unpin(BufferPoolManager* bpm, int frame_id);
-bool lru_replacer_evict(BufferPoolManager* bpm, int* frame_id);
+// 调试日志，仅在 bpm->verbose 打开时输出
+#define BPM_LOG(bpm, ...) do { if ((bpm)->verbose) printf(__VA_ARGS__); } while (0)
+
+// --- 内部辅助函数 (后台刷盘) ---
+static void* flusher_main(void* arg);
+static void wake_flusher(BufferPoolManager* bpm);
+
+// --- 内部辅助函数 (页表) ---
+int page_table_find(BufferPoolShard* shard, page_id_t page_id);
+void page_table_insert(BufferPoolShard* shard, page_id_t page_id, int frame_id);
+void page_table_remove(BufferPoolShard* shard, page_id_t page_id);
 
 
 // --- 磁盘管理器实现 ---
 
+static const char FSM_MAGIC[8] = { 'D', 'B', 'L', 'A', 'B', 'F', 'S', 'M' };
+
+// 文件头: 8 字节魔数，8 字节 next_page_id，4 字节页面大小
+#define FSM_NEXT_OFFSET 8
+#define FSM_PAGE_SIZE_OFFSET 16
+
+// 把 next_page_id 和页面大小写进 FSM 文件头
+static void fsm_write_header(DiskManager* dm, page_id_t next_page_id) {
+    char header[FSM_HEADER_SIZE];
+    memset(header, 0, sizeof(header));
+    memcpy(header, FSM_MAGIC, sizeof(FSM_MAGIC));
+    int64_t next = next_page_id;
+    memcpy(header + FSM_NEXT_OFFSET, &next, sizeof(next));
+    int32_t page_size = dm->page_size;
+    memcpy(header + FSM_PAGE_SIZE_OFFSET, &page_size, sizeof(page_size));
+    if (pwrite(dm->fsm_file_descriptor, header, sizeof(header), 0) != (ssize_t)sizeof(header)) {
+        perror("写入空闲空间映射失败");
+    }
+}
+
+// 位图容量不够时按两倍扩大，新增的部分都是 0 (已分配)
+static void fsm_reserve(DiskManager* dm, page_id_t page_id) {
+    size_t need = (size_t)page_id / 8 + 1;
+    if (need <= dm->fsm_bytes) return;
+    size_t bytes = dm->fsm_bytes > 0 ? dm->fsm_bytes : PAGE_SIZE;
+    while (bytes < need) bytes *= 2;
+    dm->fsm_bits = (uint8_t*)realloc(dm->fsm_bits, bytes);
+    memset(dm->fsm_bits + dm->fsm_bytes, 0, bytes - dm->fsm_bytes);
+    dm->fsm_bytes = bytes;
+}
+
+// 修改一位并把所在的字节写回 FSM 文件。崩溃时已分配出去的页面不会在 FSM 中仍显示为空闲
+static void fsm_set(DiskManager* dm, page_id_t page_id, bool free_page) {
+    fsm_reserve(dm, page_id);
+    uint8_t* byte = &dm->fsm_bits[page_id / 8];
+    uint8_t mask = (uint8_t)(1u << (page_id % 8));
+    *byte = free_page ? (*byte | mask) : (*byte & ~mask);
+    if (pwrite(dm->fsm_file_descriptor, byte, 1, FSM_HEADER_SIZE + page_id / 8) != 1) {
+        perror("写入空闲空间映射失败");
+    }
+}
+
+static bool fsm_is_free(const DiskManager* dm, page_id_t page_id) {
+    return (size_t)page_id / 8 < dm->fsm_bytes && (dm->fsm_bits[page_id / 8] >> (page_id % 8)) & 1;
+}
+
+// 读入 FSM 文件。文件不存在或不完整时从空映射开始，页号游标取数据文件的大小 (页数)。
+// 文件头中的页面大小和 dm->page_size 不一致时返回 false
+static bool fsm_load(DiskManager* dm, page_id_t data_pages) {
+    dm->fsm_bits = NULL;
+    dm->fsm_bytes = 0;
+    dm->free_pages = 0;
+    dm->fsm_hint = 0;
+    dm->next_page_id = data_pages;
+
+    char header[FSM_HEADER_SIZE];
+    off_t fsm_size = lseek(dm->fsm_file_descriptor, 0, SEEK_END);
+    if (fsm_size < FSM_HEADER_SIZE ||
+        pread(dm->fsm_file_descriptor, header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+        memcmp(header, FSM_MAGIC, sizeof(FSM_MAGIC)) != 0) {
+        fsm_write_header(dm, dm->next_page_id);
+        return true;
+    }
+    int32_t page_size;
+    memcpy(&page_size, header + FSM_PAGE_SIZE_OFFSET, sizeof(page_size));
+    if (page_size == 0) page_size = PAGE_SIZE; // 记录页面大小之前创建的文件
+    if (page_size != dm->page_size) {
+        fprintf(stderr, "磁盘管理器: 错误! 表空间的页面大小是 %d，不是 %d.\n", page_size, dm->page_size);
+        return false;
+    }
+    // 正常关闭时文件头中是准确的游标；崩溃后是最后一次预留的区的末尾，最多浪费一个区。
+    // 数据文件的长度包含预留了但还没分配的页面，所以有文件头时以文件头为准
+    int64_t next;
+    memcpy(&next, header + FSM_NEXT_OFFSET, sizeof(next));
+    dm->next_page_id = (page_id_t)next;
+
+    size_t bytes = (size_t)(fsm_size - FSM_HEADER_SIZE);
+    if (bytes > 0) {
+        fsm_reserve(dm, (page_id_t)(bytes * 8 - 1));
+        if (pread(dm->fsm_file_descriptor, dm->fsm_bits, bytes, FSM_HEADER_SIZE) != (ssize_t)bytes) {
+            perror("读取空闲空间映射失败");
+            memset(dm->fsm_bits, 0, dm->fsm_bytes);
+        }
+        for (size_t i = 0; i < bytes; i++) {
+            dm->free_pages += __builtin_popcount(dm->fsm_bits[i]);
+        }
+    }
+    return true;
+}
+
+// 第 file 个数据文件中第 local 页的页号，disk_manager_locate 的逆映射
+static page_id_t tablespace_page_id(const DiskManager* dm, int file, page_id_t local) {
+    if (dm->layout == TABLESPACE_SEGMENTED) {
+        return (page_id_t)file * dm->file_pages + local;
+    }
+    page_id_t stripe = (local / dm->stripe_pages) * dm->num_files + file;
+    return stripe * dm->stripe_pages + local % dm->stripe_pages;
+}
+
+void init_tablespace_config(TablespaceConfig* config) {
+    memset(config, 0, sizeof(*config));
+    config->layout = TABLESPACE_SEGMENTED;
+    config->file_pages = 0;
+    config->stripe_pages = EXTENT_PAGES;
+    config->direct_io = false;
+    config->page_size = PAGE_SIZE;
+}
+
+static void close_data_files(DiskManager* dm) {
+    for (int i = 0; i < dm->num_files; i++) {
+        close(dm->file_descriptors[i]);
+    }
+}
+
 DiskManager* create_disk_manager(const char* db_file) {
+    TablespaceConfig config;
+    init_tablespace_config(&config);
+    config.files[0] = db_file;
+    config.num_files = 1;
+    return create_disk_manager_ex(&config);
+}
+
+DiskManager* create_disk_manager_ex(const TablespaceConfig* config) {
+    if (config->num_files < 1 || config->num_files > MAX_TABLESPACE_FILES) {
+        fprintf(stderr, "磁盘管理器: 错误! 数据文件数必须在 1 到 %d 之间.\n", MAX_TABLESPACE_FILES);
+        return NULL;
+    }
+    if (config->num_files > 1 && config->layout == TABLESPACE_SEGMENTED && config->file_pages <= 0) {
+        fprintf(stderr, "磁盘管理器: 错误! 分段表空间必须指定每个文件的页数.\n");
+        return NULL;
+    }
+    if (config->layout == TABLESPACE_STRIPED && config->stripe_pages <= 0) {
+        fprintf(stderr, "磁盘管理器: 错误! 条带的页数必须大于 0.\n");
+        return NULL;
+    }
+    if (config->page_size < MIN_PAGE_SIZE || config->page_size > MAX_PAGE_SIZE ||
+        (config->page_size & (config->page_size - 1)) != 0) {
+        fprintf(stderr, "磁盘管理器: 错误! 页面大小必须是 %d 到 %d 之间的 2 的幂.\n", MIN_PAGE_SIZE, MAX_PAGE_SIZE);
+        return NULL;
+    }
+
     DiskManager* dm = (DiskManager*)malloc(sizeof(DiskManager));
-    dm->file_name = strdup(db_file);
-    dm->file_descriptor = open(db_file, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
-    if (dm->file_descriptor == -1) {
-        perror("无法打开或创建数据库文件");
+    dm->file_name = strdup(config->files[0]);
+    dm->page_size = config->page_size;
+    dm->layout = config->layout;
+    dm->stripe_pages = config->stripe_pages;
+    dm->file_pages = config->file_pages;
+    if (dm->layout == TABLESPACE_STRIPED && dm->file_pages > 0) {
+        dm->file_pages -= dm->file_pages % dm->stripe_pages; // 文件中只存放完整的条带
+    }
+    dm->max_pages = dm->file_pages > 0 ? dm->file_pages * config->num_files : INT64_MAX;
+    dm->direct_io = config->direct_io;
+
+    dm->num_files = 0;
+    for (int i = 0; i < config->num_files; i++) {
+        int fd = open(config->files[i], O_RDWR | O_CREAT | (dm->direct_io ? O_DIRECT : 0), S_IRUSR | S_IWUSR);
+        if (fd == -1 && dm->direct_io && errno == EINVAL) {
+            // 文件系统不支持 O_DIRECT (例如 tmpfs) 时整个表空间退回经过页缓存的 I/O
+            fprintf(stderr, "磁盘管理器: %s 不支持 O_DIRECT，改用普通 I/O.\n", config->files[i]);
+            dm->direct_io = false;
+            for (int j = 0; j < dm->num_files; j++) {
+                fcntl(dm->file_descriptors[j], F_SETFL, fcntl(dm->file_descriptors[j], F_GETFL) & ~O_DIRECT);
+            }
+            fd = open(config->files[i], O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+        }
+        if (fd == -1) {
+            perror("无法打开或创建数据库文件");
+            close_data_files(dm);
+            free(dm->file_name);
+            free(dm);
+            return NULL;
+        }
+        dm->file_descriptors[dm->num_files++] = fd;
+    }
+
+    // FSM 只有一份，放在第一个数据文件旁边
+    size_t name_length = strlen(dm->file_name);
+    char* fsm_file = (char*)malloc(name_length + 5);
+    memcpy(fsm_file, dm->file_name, name_length);
+    memcpy(fsm_file + name_length, ".fsm", 5);
+    dm->fsm_file_descriptor = open(fsm_file, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+    free(fsm_file);
+    if (dm->fsm_file_descriptor == -1) {
+        perror("无法打开或创建空闲空间映射文件");
+        close_data_files(dm);
         free(dm->file_name);
         free(dm);
         return NULL;
     }
+
+    // 在内存中维护下一个可分配的页号，保证连续的 new_page 拿到不同的页。
+    // 文件中已有的页数取各个文件最后一页的页号中最大的一个加一
+    page_id_t data_pages = 0;
+    for (int i = 0; i < dm->num_files; i++) {
+        off_t file_size = lseek(dm->file_descriptors[i], 0, SEEK_END);
+        page_id_t local_pages = (page_id_t)((file_size + dm->page_size - 1) / dm->page_size);
+        if (local_pages > 0) {
+            page_id_t end = tablespace_page_id(dm, i, local_pages - 1) + 1;
+            if (end > data_pages) data_pages = end;
+        }
+    }
+    if (!fsm_load(dm, data_pages)) {
+        close(dm->fsm_file_descriptor);
+        free(dm->fsm_bits);
+        close_data_files(dm);
+        free(dm->file_name);
+        free(dm);
+        return NULL;
+    }
+    dm->extent_end = data_pages;
+    if (dm->extent_end < dm->next_page_id) dm->extent_end = dm->next_page_id;
+    dm->fallocate_supported = true;
+    pthread_mutex_init(&dm->alloc_lock, NULL);
+    dm->mapped = false;
+    for (int i = 0; i < MAX_TABLESPACE_FILES; i++) {
+        dm->maps[i] = NULL;
+        dm->map_sizes[i] = 0;
+    }
     return dm;
 }
 
 void destroy_disk_manager(DiskManager* disk_manager) {
     if (disk_manager) {
-        close(disk_manager->file_descriptor);
+        // 正常关闭时记下准确的游标，重新打开后预留了但没用到的页面可以继续分配
+        fsm_write_header(disk_manager, disk_manager->next_page_id);
+        fdatasync(disk_manager->fsm_file_descriptor);
+        close(disk_manager->fsm_file_descriptor);
+        free(disk_manager->fsm_bits);
+        pthread_mutex_destroy(&disk_manager->alloc_lock);
+        for (int i = 0; i < disk_manager->num_files; i++) {
+            if (disk_manager->maps[i]) munmap(disk_manager->maps[i], disk_manager->map_sizes[i]);
+        }
+        close_data_files(disk_manager);
         free(disk_manager->file_name);
         free(disk_manager);
     }
 }
 
-void read_page_from_disk(DiskManager* disk_manager, page_id_t page_id, char* page_data) {
-    off_t offset = page_id * PAGE_SIZE;
-    if (lseek(disk_manager->file_descriptor, offset, SEEK_SET) == -1) {
-        perror("读页面时定位文件失败");
-        return;
+void sync_disk_manager(DiskManager* disk_manager) {
+    for (int i = 0; i < disk_manager->num_files; i++) {
+        if (fdatasync(disk_manager->file_descriptors[i]) != 0) {
+            perror("数据文件刷盘失败");
+        }
+    }
+}
+
+// 从 page_id 开始的 count 页中，在同一个文件里连续存放的页数 (不会跨过文件或条带的边界)
+static int contiguous_pages(const DiskManager* dm, page_id_t page_id, int count) {
+    if (dm->num_files == 1) return count;
+    page_id_t unit = dm->layout == TABLESPACE_SEGMENTED ? dm->file_pages : dm->stripe_pages;
+    page_id_t left = unit - page_id % unit;
+    return left < count ? (int)left : count;
+}
+
+// 页面所在的文件 (下标) 和文件内偏移，页号和偏移都按 64 位计算。超出表空间容量时返回 -1
+static int locate_file(const DiskManager* dm, page_id_t page_id, off_t* offset) {
+    if (page_id >= dm->max_pages) {
+        *offset = 0;
+        return -1;
+    }
+    if (dm->num_files == 1) {
+        *offset = (off_t)page_id * dm->page_size;
+        return 0;
+    }
+    int file;
+    page_id_t local;
+    if (dm->layout == TABLESPACE_SEGMENTED) {
+        file = (int)(page_id / dm->file_pages);
+        local = page_id % dm->file_pages;
+    } else {
+        page_id_t stripe = page_id / dm->stripe_pages;
+        file = (int)(stripe % dm->num_files);
+        local = (stripe / dm->num_files) * dm->stripe_pages + page_id % dm->stripe_pages;
+    }
+    *offset = (off_t)local * dm->page_size;
+    return file;
+}
+
+// 同步和异步 I/O 都通过这里定位页面
+int disk_manager_locate(DiskManager* disk_manager, page_id_t page_id, off_t* offset) {
+    int file = locate_file(disk_manager, page_id, offset);
+    return file == -1 ? -1 : disk_manager->file_descriptors[file];
+}
+
+bool disk_manager_map(DiskManager* disk_manager, MmapAdvice advice) {
+    if (disk_manager->mapped) return true;
+    for (int i = 0; i < disk_manager->num_files; i++) {
+        off_t file_size = lseek(disk_manager->file_descriptors[i], 0, SEEK_END);
+        size_t size = (size_t)(file_size / disk_manager->page_size) * disk_manager->page_size; // 只映射完整的页面
+        if (size == 0) continue;
+        void* map = mmap(NULL, size, PROT_READ, MAP_SHARED, disk_manager->file_descriptors[i], 0);
+        if (map == MAP_FAILED) {
+            perror("无法映射数据库文件");
+            for (int j = 0; j < i; j++) {
+                if (disk_manager->maps[j]) munmap(disk_manager->maps[j], disk_manager->map_sizes[j]);
+                disk_manager->maps[j] = NULL;
+                disk_manager->map_sizes[j] = 0;
+            }
+            return false;
+        }
+        madvise(map, size, advice == MMAP_SEQUENTIAL ? MADV_SEQUENTIAL : MADV_RANDOM);
+        disk_manager->maps[i] = (char*)map;
+        disk_manager->map_sizes[i] = size;
     }
-    ssize_t bytes_read = read(disk_manager->file_descriptor, page_data, PAGE_SIZE);
+    disk_manager->mapped = true;
+    return true;
+}
+
+const char* disk_manager_view(DiskManager* disk_manager, page_id_t page_id) {
+    if (!disk_manager->mapped || page_id < 0) return NULL;
+    off_t offset;
+    int file = locate_file(disk_manager, page_id, &offset);
+    if (file == -1 || disk_manager->maps[file] == NULL ||
+        (size_t)offset + disk_manager->page_size > disk_manager->map_sizes[file]) {
+        return NULL;
+    }
+    return disk_manager->maps[file] + offset;
+}
+
+// 提示内核把映射中的 [page_id, page_id + count) 提前读入页缓存 (映射模式下的预读)
+static void disk_manager_willneed(DiskManager* dm, page_id_t page_id, page_id_t count) {
+    for (page_id_t i = 0; i < count; ) {
+        int n = contiguous_pages(dm, page_id + i, (int)(count - i));
+        const char* view = disk_manager_view(dm, page_id + i);
+        if (view == NULL) break;
+        // madvise 要求地址按系统页对齐，页面大小是系统页大小的整数倍
+        madvise((void*)view, (size_t)n * dm->page_size, MADV_WILLNEED);
+        i += n;
+    }
+}
+
+// O_DIRECT 模式下缓冲区没有对齐时需要经过一块对齐的中转缓冲区。
+// 缓冲池的帧总是对齐的，只有直接调用磁盘管理器的代码才会走到这里
+static inline bool needs_bounce(const DiskManager* dm, const char* data) {
+    return dm->direct_io && (uintptr_t)data % DIRECT_IO_ALIGN != 0;
+}
+
+static char* alloc_bounce(const DiskManager* dm) {
+    void* buffer = NULL;
+    if (posix_memalign(&buffer, DIRECT_IO_ALIGN, dm->page_size) != 0) return NULL;
+    return (char*)buffer;
+}
+
+// 使用 pread/pwrite 按位置读写，一次系统调用，共享文件描述符时也不需要加锁
+void read_page_from_disk(DiskManager* disk_manager, page_id_t page_id, char* page_data) {
+    char* bounce = needs_bounce(disk_manager, page_data) ? alloc_bounce(disk_manager) : NULL;
+    off_t offset;
+    int fd = disk_manager_locate(disk_manager, page_id, &offset);
+    ssize_t bytes_read = pread(fd, bounce ? bounce : page_data, disk_manager->page_size, offset);
     if (bytes_read < 0) {
         perror("读取页面数据失败");
+        bytes_read = 0;
+    }
+    if (bounce) {
+        memcpy(page_data, bounce, bytes_read);
+        free(bounce);
     }
     // 如果读取的字节数少于一个页面，说明是文件末尾，用0填充剩余部分
-    if (bytes_read < PAGE_SIZE) {
-        memset(page_data + bytes_read, 0, PAGE_SIZE - bytes_read);
+    if (bytes_read < disk_manager->page_size) {
+        memset(page_data + bytes_read, 0, disk_manager->page_size - bytes_read);
     }
 }
 
 void write_page_to_disk(DiskManager* disk_manager, page_id_t page_id, const char* page_data) {
-    off_t offset = page_id * PAGE_SIZE;
-    if (lseek(disk_manager->file_descriptor, offset, SEEK_SET) == -1) {
-        perror("写页面时定位文件失败");
-        return;
-    }
-    ssize_t bytes_written = write(disk_manager->file_descriptor, page_data, PAGE_SIZE);
-    if (bytes_written != PAGE_SIZE) {
+    char* bounce = needs_bounce(disk_manager, page_data) ? alloc_bounce(disk_manager) : NULL;
+    if (bounce) memcpy(bounce, page_data, disk_manager->page_size);
+    off_t offset;
+    int fd = disk_manager_locate(disk_manager, page_id, &offset);
+    ssize_t bytes_written = pwrite(fd, bounce ? bounce : page_data, disk_manager->page_size, offset);
+    if (bytes_written != disk_manager->page_size) {
         perror("写入页面数据失败");
     }
+    free(bounce);
+}
+
+// 把页号连续的 count 个页面用 pwritev 一次写出，相邻的脏页合并成一次系统调用。
+// 跨过文件或条带边界时在边界处拆开，分别写到各自的文件
+void write_pages_to_disk(DiskManager* disk_manager, page_id_t first_page_id, char* const* pages, int count) {
+    struct iovec iov[WRITE_COALESCE_MAX];
+    while (count > 0) {
+        int n = contiguous_pages(disk_manager, first_page_id, count < WRITE_COALESCE_MAX ? count : WRITE_COALESCE_MAX);
+        for (int i = 0; i < n; i++) {
+            iov[i].iov_base = pages[i];
+            iov[i].iov_len = disk_manager->page_size;
+        }
+        off_t offset;
+        int fd = disk_manager_locate(disk_manager, first_page_id, &offset);
+        ssize_t bytes_written = pwritev(fd, iov, n, offset);
+        if (bytes_written != (ssize_t)n * disk_manager->page_size) {
+            // 写了一部分时退回逐页写，保证每一页都落盘
+            if (bytes_written < 0) perror("批量写入页面数据失败");
+            for (int i = 0; i < n; i++) {
+                write_page_to_disk(disk_manager, first_page_id + i, pages[i]);
+            }
+        }
+        first_page_id += n;
+        pages += n;
+        count -= n;
+    }
+}
+
+// 游标到达已预留空间的末尾时再预留一个区。文件长度在这里一次变化一个区，
+// 而不是每写一个新页面都改一次文件大小。区跨过文件或条带边界时分段预留。
+// 调用前必须持有 alloc_lock
+static void reserve_extent(DiskManager* dm) {
+    if (dm->extent_end < dm->next_page_id) dm->extent_end = dm->next_page_id; // 恢复时游标可能被推到预留区之后
+    page_id_t end = dm->extent_end + EXTENT_PAGES;
+    if (end > dm->max_pages) end = dm->max_pages;
+    for (page_id_t page_id = dm->extent_end; page_id < end && dm->fallocate_supported; ) {
+        int n = contiguous_pages(dm, page_id, (int)(end - page_id));
+        off_t offset;
+        int fd = disk_manager_locate(dm, page_id, &offset);
+        if (fallocate(fd, 0, offset, (off_t)n * dm->page_size) != 0) {
+            // 文件系统不支持时退化为写页面时再扩展文件
+            dm->fallocate_supported = false;
+        }
+        page_id += n;
+    }
+    dm->extent_end = end;
+    // 崩溃后从预留区的末尾继续分配，不会把已经用过的页号再分配一次。
+    // 文件头先落盘，再把这个区里的页号分配出去
+    fsm_write_header(dm, end);
+    fdatasync(dm->fsm_file_descriptor);
 }
 
 page_id_t allocate_page_on_disk(DiskManager* disk_manager) {
-    // 简单地将新页面追加到文件末尾
-    off_t file_size = lseek(disk_manager->file_descriptor, 0, SEEK_END);
-    return file_size / PAGE_SIZE;
+    pthread_mutex_lock(&disk_manager->alloc_lock);
+    page_id_t page_id = INVALID_PAGE_ID;
+    if (disk_manager->free_pages > 0) {
+        // 优先复用被释放的页面，从上次找到的位置往后找，找到末尾再从头找
+        page_id_t limit = (page_id_t)(disk_manager->fsm_bytes * 8);
+        for (page_id_t i = 0; i < limit; i++) {
+            page_id_t candidate = (disk_manager->fsm_hint + i) % limit;
+            if (disk_manager->fsm_bits[candidate / 8] == 0) {
+                i += 7 - candidate % 8; // 整个字节都不空闲，跳到下一个字节
+                continue;
+            }
+            if (fsm_is_free(disk_manager, candidate)) {
+                page_id = candidate;
+                break;
+            }
+        }
+        if (page_id != INVALID_PAGE_ID) {
+            fsm_set(disk_manager, page_id, false);
+            disk_manager->free_pages--;
+            disk_manager->fsm_hint = page_id + 1;
+        }
+    }
+    if (page_id == INVALID_PAGE_ID) {
+        // 新页面追加到文件末尾。文件要等页面被刷盘时才会写入内容，
+        // 所以不能每次都用文件大小计算页号，而是使用内存中的游标
+        if (disk_manager->next_page_id >= disk_manager->extent_end) {
+            reserve_extent(disk_manager);
+        }
+        if (disk_manager->next_page_id < disk_manager->extent_end) {
+            page_id = disk_manager->next_page_id;
+            __atomic_store_n(&disk_manager->next_page_id, page_id + 1, __ATOMIC_RELAXED); // 预读不加锁读取游标
+        } else {
+            fprintf(stderr, "磁盘管理器: 错误! 表空间已满 (%lld 页).\n", (long long)disk_manager->max_pages);
+        }
+    }
+    pthread_mutex_unlock(&disk_manager->alloc_lock);
+    return page_id;
+}
+
+bool deallocate_page_on_disk(DiskManager* disk_manager, page_id_t page_id) {
+    pthread_mutex_lock(&disk_manager->alloc_lock);
+    bool ok = page_id >= 0 && page_id < disk_manager->next_page_id && !fsm_is_free(disk_manager, page_id);
+    if (ok) {
+        fsm_set(disk_manager, page_id, true);
+        disk_manager->free_pages++;
+        if (page_id < disk_manager->fsm_hint) disk_manager->fsm_hint = page_id;
+    }
+    pthread_mutex_unlock(&disk_manager->alloc_lock);
+    return ok;
+}
+
+
+// --- 分片辅助函数 ---
+
+// 与页表槽位使用不同的乘数，避免同一分片内的页面在页表中挤到一起
+static inline BufferPoolShard* shard_of(BufferPoolManager* bpm, page_id_t page_id) {
+    uint64_t h = (uint64_t)page_id * 0xC2B2AE3D27D4EB4Full;
+    return &bpm->shards[(uint32_t)(h >> 32) % (uint32_t)bpm->num_shards];
+}
+
+static inline void shard_lock(BufferPoolManager* bpm, BufferPoolShard* shard) {
+    if (bpm->concurrent) pthread_mutex_lock(&shard->latch);
+}
+
+static inline void shard_unlock(BufferPoolManager* bpm, BufferPoolShard* shard) {
+    if (bpm->concurrent) pthread_mutex_unlock(&shard->latch);
+}
+
+// 等待本分片上进行中的 I/O 完成，调用前必须持有分片锁。
+// 非并发模式下没有其他线程，不会走到这里
+static inline void shard_wait_io(BufferPoolManager* bpm, BufferPoolShard* shard) {
+    if (bpm->concurrent) pthread_cond_wait(&shard->io_done, &shard->latch);
+}
+
+// 分片按预留的 frame_capacity 帧分配页表、空闲列表和替换器，扩大缓冲池时不需要重建
+static void init_shard(BufferPoolShard* shard, int frame_begin, int frame_count, int frame_capacity,
+                       ReplacerType replacer) {
+    shard->frame_begin = frame_begin;
+    shard->frame_count = frame_count;
+    shard->frame_capacity = frame_capacity;
+
+    // 写回脏页期间旧页的映射会保留到写完为止，每帧最多同时占两个槽位
+    int slots = 1;
+    while (slots <= frame_capacity * 2) slots <<= 1;
+    shard->page_table = (PageTableEntry*)malloc(slots * sizeof(PageTableEntry));
+    shard->page_table_mask = slots - 1;
+    for (int i = 0; i < slots; i++) {
+        shard->page_table[i].page_id = INVALID_PAGE_ID;
+    }
+
+    shard->free_list = (int*)malloc(frame_capacity * sizeof(int));
+    for (int i = 0; i < frame_count; i++) {
+        shard->free_list[i] = frame_begin + i; // 所有帧最初都是空闲的
+    }
+    shard->free_list_size = frame_count;
+
+    shard->replacer = create_replacer(replacer, frame_begin, frame_capacity);
+
+    pthread_mutex_init(&shard->latch, NULL);
+    pthread_cond_init(&shard->io_done, NULL);
+    shard->retiring_frame = -1;
 }
 
 
 // --- 缓冲池管理器实现 ---
 
+// 分配帧缓冲区: 足够大时先试显式大页，不行再按大页对齐分配并建议内核使用透明大页。
+// 每一帧都按页面大小对齐，可以直接用于 O_DIRECT
+static char* alloc_frame_data(size_t size, bool huge_pages, size_t* mapped_size) {
+    *mapped_size = 0;
+    if (huge_pages && size >= HUGE_PAGE_SIZE) {
+        size_t rounded = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+        void* data = mmap(NULL, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (data != MAP_FAILED) {
+            *mapped_size = rounded;
+            return (char*)data;
+        }
+    }
+    size_t alignment = size >= HUGE_PAGE_SIZE ? HUGE_PAGE_SIZE : DIRECT_IO_ALIGN;
+    void* data = NULL;
+    if (posix_memalign(&data, alignment, size) != 0) return NULL;
+    if (size >= HUGE_PAGE_SIZE) madvise(data, size, MADV_HUGEPAGE);
+    return (char*)data;
+}
+
+static void free_frame_data(char* data, size_t mapped_size) {
+    if (mapped_size > 0) {
+        munmap(data, mapped_size);
+    } else {
+        free(data);
+    }
+}
+
+// 帧回到空闲状态，缓冲区指回帧自己的那一块
+static void reset_frame(BufferPoolManager* bpm, int frame_id) {
+    Page* page = &bpm->pages[frame_id];
+    page->data = bpm->frame_data + (size_t)frame_id * bpm->page_size;
+    page->mapped = false;
+    page->page_id = INVALID_PAGE_ID;
+    page->pin_count = 0;
+    page->is_dirty = false;
+    page->io_pending = false;
+    page->page_lsn = INVALID_LSN;
+    page->rec_lsn = INVALID_LSN;
+}
+
+void init_buffer_pool_config(BufferPoolConfig* config) {
+    config->pool_size = BUFFER_POOL_SIZE;
+    config->max_pool_size = 0;
+    config->page_size = 0;
+    config->num_shards = 1;
+    config->concurrent = false;
+    config->replacer = REPLACER_LRU;
+    config->readahead_pages = READAHEAD_PAGES;
+    config->use_io_uring = true;
+    config->flusher_interval_ms = 0;
+    config->flusher_clean_target = 0;
+    config->wal = NULL;
+    config->checkpoint_interval_ms = 0;
+    config->huge_pages = true;
+}
+
 BufferPoolManager* create_buffer_pool_manager(DiskManager* disk_manager) {
+    BufferPoolConfig config;
+    init_buffer_pool_config(&config);
+    return create_buffer_pool_manager_ex(disk_manager, &config);
+}
+
+BufferPoolManager* create_buffer_pool_manager_ex(DiskManager* disk_manager, const BufferPoolConfig* config) {
+    if (config->pool_size <= 0) {
+        fprintf(stderr, "缓冲池: 错误! pool_size 必须大于 0.\n");
+        return NULL;
+    }
+    if (config->page_size != 0 && config->page_size != disk_manager->page_size) {
+        fprintf(stderr, "缓冲池: 错误! 页面大小 %d 和表空间的页面大小 %d 不一致.\n",
+                config->page_size, disk_manager->page_size);
+        return NULL;
+    }
     BufferPoolManager* bpm = (BufferPoolManager*)malloc(sizeof(BufferPoolManager));
     bpm->disk_manager = disk_manager;
-    
-    bpm->pages = (Page*)malloc(BUFFER_POOL_SIZE * sizeof(Page));
-    bpm->page_table = (int*)malloc(TABLE_MAX_PAGES * sizeof(int)); // 假设最多管理TABLE_MAX_PAGES个页
-    bpm->free_list = (int*)malloc(BUFFER_POOL_SIZE * sizeof(int));
-    bpm->lru_replacer = (int*)malloc(BUFFER_POOL_SIZE * sizeof(int));
-    bpm->lru_in_replacer = (bool*)calloc(BUFFER_POOL_SIZE, sizeof(bool));
-
-    for (int i = 0; i < TABLE_MAX_PAGES; i++) {
-        bpm->page_table[i] = INVALID_PAGE_ID;
-    }
-    for (int i = 0; i < BUFFER_POOL_SIZE; i++) {
-        bpm->pages[i].page_id = INVALID_PAGE_ID;
-        bpm->pages[i].pin_count = 0;
-        bpm->pages[i].is_dirty = false;
-        bpm->free_list[i] = i; // 所有帧最初都是空闲的
-    }
-    bpm->free_list_size = BUFFER_POOL_SIZE;
-    bpm->lru_head = 0;
-    bpm->lru_tail = 0;
+    bpm->pool_size = config->pool_size;
+    bpm->page_size = disk_manager->page_size;
+    int max_pool_size = config->max_pool_size > config->pool_size ? config->max_pool_size : config->pool_size;
+    // 每个分片至少一帧
+    bpm->num_shards = config->num_shards < 1 ? 1 : config->num_shards;
+    if (bpm->num_shards > bpm->pool_size) bpm->num_shards = bpm->pool_size;
+    bpm->concurrent = config->concurrent;
+    bpm->verbose = true;
+    bpm->wal = config->wal;
+    if (bpm->wal) bpm->wal->page_size = bpm->page_size;
+
+    // 预读窗口不超过缓冲池的 1/4，也不超过一批 I/O 的上限
+    bpm->readahead_pages = config->readahead_pages;
+    if (bpm->readahead_pages > bpm->pool_size / 4) bpm->readahead_pages = bpm->pool_size / 4;
+    if (bpm->readahead_pages > PREFETCH_BATCH) bpm->readahead_pages = PREFETCH_BATCH;
+    bpm->readahead_last = INVALID_PAGE_ID;
+    bpm->readahead_next = INVALID_PAGE_ID;
+    bpm->readahead_run = 0;
+    bpm->prefetch_io_count = bpm->concurrent ? PREFETCH_IO_MAX : 1;
+    bpm->prefetch_ios = (AsyncIO**)malloc(bpm->prefetch_io_count * sizeof(AsyncIO*));
+    for (int i = 0; i < bpm->prefetch_io_count; i++) {
+        bpm->prefetch_ios[i] = create_async_io(disk_manager, PREFETCH_BATCH + 1, config->use_io_uring);
+    }
+    bpm->prefetch_io_free = bpm->prefetch_io_count;
+    pthread_mutex_init(&bpm->prefetch_lock, NULL);
+
+    // 按 max_pool_size 一次预留所有帧的地址空间，帧和 Page 结构在调整大小时不会移动。
+    // 没用到的帧缓冲区不会被访问，不占物理内存。可以调整大小时不使用显式大页，
+    // 否则预留的部分也会占住大页
+    bpm->frame_capacity = max_pool_size;
+    bpm->pages = (Page*)malloc(bpm->frame_capacity * sizeof(Page));
+    bpm->frame_data = alloc_frame_data((size_t)bpm->frame_capacity * bpm->page_size,
+                                       config->huge_pages && max_pool_size == bpm->pool_size, &bpm->frame_data_size);
+    bpm->writebacks = (DirtyPageEntry*)malloc(bpm->frame_capacity * sizeof(DirtyPageEntry));
+    for (int i = 0; i < bpm->frame_capacity; i++) {
+        reset_frame(bpm, i);
+        bpm->writebacks[i].page_id = INVALID_PAGE_ID;
+        bpm->writebacks[i].rec_lsn = INVALID_LSN;
+    }
+
+    // 帧平均分给各个分片，余数分给前面的分片。每个分片预留的帧按 max_pool_size 同样分配
+    bpm->shards = (BufferPoolShard*)malloc(bpm->num_shards * sizeof(BufferPoolShard));
+    int frame_begin = 0;
+    for (int s = 0; s < bpm->num_shards; s++) {
+        int frame_count = bpm->pool_size / bpm->num_shards + (s < bpm->pool_size % bpm->num_shards ? 1 : 0);
+        int frame_capacity = max_pool_size / bpm->num_shards + (s < max_pool_size % bpm->num_shards ? 1 : 0);
+        init_shard(&bpm->shards[s], frame_begin, frame_count, frame_capacity, config->replacer);
+        frame_begin += frame_capacity;
+    }
+    pthread_mutex_init(&bpm->resize_lock, NULL);
+
+    // 后台刷盘线程 (也负责定期检查点) 和调用者并发访问分片，所以启用它时总是按并发模式加锁。
+    // clean_target 没有指定时取缓冲池的 1/8
+    bpm->flusher_interval_ms = config->flusher_interval_ms;
+    bpm->flusher_clean_target = config->flusher_clean_target > 0 ? config->flusher_clean_target : bpm->pool_size / 8;
+    if (bpm->flusher_clean_target < 1) bpm->flusher_clean_target = 1;
+    bpm->checkpoint_interval_ms = config->wal ? config->checkpoint_interval_ms : 0;
+    bpm->flusher_running = bpm->flusher_interval_ms > 0 || bpm->checkpoint_interval_ms > 0;
+    bpm->flusher_started = false;
+    pthread_mutex_init(&bpm->flusher_lock, NULL);
+    pthread_cond_init(&bpm->flusher_wake, NULL);
+    if (bpm->flusher_running) {
+        bpm->concurrent = true;
+        bpm->flusher_started = pthread_create(&bpm->flusher_thread, NULL, flusher_main, bpm) == 0;
+    }
 
     return bpm;
 }
 
 void destroy_buffer_pool_manager(BufferPoolManager* bpm) {
     if (bpm) {
+        if (bpm->flusher_started) {
+            pthread_mutex_lock(&bpm->flusher_lock);
+            bpm->flusher_running = false;
+            pthread_cond_signal(&bpm->flusher_wake);
+            pthread_mutex_unlock(&bpm->flusher_lock);
+            pthread_join(bpm->flusher_thread, NULL);
+        }
+        pthread_mutex_destroy(&bpm->flusher_lock);
+        pthread_cond_destroy(&bpm->flusher_wake);
+        // 销毁时已经没有其他线程访问缓冲池，仍被钉住的脏页也一起写回
+        bpm->concurrent = false;
         flush_all_pages(bpm);
+        for (int s = 0; s < bpm->num_shards; s++) {
+            BufferPoolShard* shard = &bpm->shards[s];
+            free(shard->page_table);
+            free(shard->free_list);
+            destroy_replacer(shard->replacer);
+            pthread_mutex_destroy(&shard->latch);
+            pthread_cond_destroy(&shard->io_done);
+        }
+        free(bpm->shards);
+        for (int i = 0; i < bpm->prefetch_io_count; i++) {
+            destroy_async_io(bpm->prefetch_ios[i]);
+        }
+        free(bpm->prefetch_ios);
+        pthread_mutex_destroy(&bpm->prefetch_lock);
+        pthread_mutex_destroy(&bpm->resize_lock);
+        free(bpm->writebacks);
+        free_frame_data(bpm->frame_data, bpm->frame_data_size);
         free(bpm->pages);
-        free(bpm->page_table);
-        free(bpm->free_list);
-        free(bpm->lru_replacer);
-        free(bpm->lru_in_replacer);
         free(bpm);
     }
 }
 
-Page* fetch_page(BufferPoolManager* bpm, page_id_t page_id) {
-    // 1. 在页表中查找页面 (缓存命中)
-    if (bpm->page_table[page_id] != INVALID_PAGE_ID) {
-        int frame_id = bpm->page_table[page_id];
-        printf("缓冲池: 缓存命中 page %d (在 frame %d).\n", page_id, frame_id);
-        bpm->pages[frame_id].pin_count++;
-        lru_replacer_pin(bpm, frame_id); // 从LRU淘汰队列中移除
-        return &bpm->pages[frame_id];
+// 访问策略的环中属于本分片的下一个位置，环中的帧仍空闲可用 (没被钉住、没被其他线程挪用) 时
+// 把它从替换器中摘下来直接复用，返回 -1 表示只能走正常的淘汰流程
+static int strategy_take_frame(BufferPoolManager* bpm, BufferPoolShard* shard,
+                               BufferAccessStrategy* strategy, int* slot) {
+    int shard_index = (int)(shard - bpm->shards);
+    int* next = &strategy->ring_next[shard_index];
+    *slot = shard_index * strategy->ring_per_shard + *next;
+    *next = (*next + 1) % strategy->ring_per_shard;
+
+    int frame_id = strategy->ring_frames[*slot];
+    if (frame_id == -1) return -1;
+    Page* page = &bpm->pages[frame_id];
+    if (page->page_id != strategy->ring_pages[*slot] || page->pin_count > 0 || page->io_pending) {
+        return -1;
     }
+    replacer_remove(shard->replacer, frame_id);
+    return frame_id;
+}
 
-    // 2. 缓存未命中，需要从磁盘加载
-    printf("缓冲池: 缓存未命中 page %d. 尝试加载...\n", page_id);
-    int frame_id = -1;
-    // 首先尝试从空闲帧列表中获取
-    if (bpm->free_list_size > 0) {
-        frame_id = bpm->free_list[--bpm->free_list_size];
-        printf("缓冲池: 使用空闲 frame %d.\n", frame_id);
+// 开始写回: 把页面的 rec_lsn 移到 writebacks 中，之后的修改会重新设置 rec_lsn，
+// 写回完成前检查点仍能看到旧的 rec_lsn。调用前必须持有分片锁
+static void begin_writeback(BufferPoolManager* bpm, int frame_id, page_id_t page_id) {
+    DirtyPageEntry* entry = &bpm->writebacks[frame_id];
+    entry->page_id = page_id;
+    entry->rec_lsn = __atomic_exchange_n(&bpm->pages[frame_id].rec_lsn, INVALID_LSN, __ATOMIC_SEQ_CST);
+}
+
+static void end_writeback(BufferPoolManager* bpm, int frame_id) {
+    bpm->writebacks[frame_id].page_id = INVALID_PAGE_ID;
+}
+
+// 被淘汰的旧页，脏页由 finish_eviction 在锁外写回
+typedef struct Victim {
+    page_id_t page_id;
+    bool dirty;
+    lsn_t page_lsn;
+} Victim;
+
+// 为 page_id 找一个帧 (访问策略的环、空闲列表或淘汰)，登记新映射并标记 io_pending，
+// 调用前必须持有分片锁。被淘汰的页由调用者在锁外调用 finish_eviction 处理。
+// 没有可用的帧时返回 -1
+static int claim_frame(BufferPoolManager* bpm, BufferPoolShard* shard, page_id_t page_id,
+                       BufferAccessStrategy* strategy, int pin_count, Victim* victim) {
+    victim->page_id = INVALID_PAGE_ID;
+    victim->dirty = false;
+    victim->page_lsn = INVALID_LSN;
+    int ring_slot = -1;
+    int frame_id = strategy ? strategy_take_frame(bpm, shard, strategy, &ring_slot) : -1;
+    if (frame_id != -1) {
+        BPM_LOG(bpm, "缓冲池: 复用访问策略环中的 frame %d.\n", frame_id);
+    } else if (shard->free_list_size > 0) {
+        // 首先尝试从空闲帧列表中获取
+        frame_id = shard->free_list[--shard->free_list_size];
+        BPM_LOG(bpm, "缓冲池: 使用空闲 frame %d.\n", frame_id);
     } else {
-        // 如果没有空闲帧，使用LRU算法淘汰一个
-        if (!lru_replacer_evict(bpm, &frame_id)) {
-            printf("缓冲池: 错误! 所有页面都被钉住，无法淘汰.\n");
-            return NULL; // 所有页都被钉住，无法获取新页
+        // 如果没有空闲帧，由替换策略选出一个淘汰
+        if (!replacer_evict(shard->replacer, &frame_id)) {
+            BPM_LOG(bpm, "缓冲池: 错误! 所有页面都被钉住，无法淘汰.\n");
+            return -1; // 所有页都被钉住，无法获取新页
         }
-        printf("缓冲池: 淘汰 frame %d 中的 page %d.\n", frame_id, bpm->pages[frame_id].page_id);
-        
-        // 如果被淘汰的页是脏页，写回磁盘
-        if (bpm->pages[frame_id].is_dirty) {
-            printf("缓冲池: 被淘汰的 page %d 是脏页，正在写回磁盘...\n", bpm->pages[frame_id].page_id);
-            write_page_to_disk(bpm->disk_manager, bpm->pages[frame_id].page_id, bpm->pages[frame_id].data);
+    }
+    if (bpm->pages[frame_id].page_id != INVALID_PAGE_ID) {
+        victim->page_id = bpm->pages[frame_id].page_id;
+        victim->dirty = bpm->pages[frame_id].is_dirty;
+        victim->page_lsn = bpm->pages[frame_id].page_lsn;
+        BPM_LOG(bpm, "缓冲池: 淘汰 frame %d 中的 page %lld.\n", frame_id, (long long)victim->page_id);
+
+        // 脏页在写回完成前保留旧映射，让并发访问旧页的线程等待，而不是从磁盘读到过期数据
+        if (!victim->dirty) {
+            page_table_remove(shard, victim->page_id);
+        } else {
+            begin_writeback(bpm, frame_id, victim->page_id);
         }
-        // 从页表中移除旧页的映射
-        bpm->page_table[bpm->pages[frame_id].page_id] = INVALID_PAGE_ID;
     }
+    if (ring_slot != -1) {
+        strategy->ring_frames[ring_slot] = frame_id;
+        strategy->ring_pages[ring_slot] = page_id;
+    }
+
+    // 占住这个帧并登记新映射，I/O 在锁外进行。帧之前可能是只读视图，先换回自己的缓冲区
+    Page* page = &bpm->pages[frame_id];
+    page->data = bpm->frame_data + (size_t)frame_id * bpm->page_size;
+    page->mapped = false;
+    page->page_id = page_id;
+    page->pin_count = pin_count;
+    page->is_dirty = false;
+    page->io_pending = true;
+    page->page_lsn = INVALID_LSN;
+    page->rec_lsn = INVALID_LSN;
+    page_table_insert(shard, page_id, frame_id);
+    replacer_record_access(shard->replacer, frame_id, page_id);
+    return frame_id;
+}
+
+// 日志先行: 页面写回磁盘之前，修改它的日志记录必须已经落盘
+static inline void wal_before_write(BufferPoolManager* bpm, lsn_t page_lsn) {
+    if (bpm->wal && page_lsn != INVALID_LSN) {
+        wal_flush(bpm->wal, page_lsn);
+    }
+}
+
+// 在锁外把被淘汰的脏页写回磁盘，之后再移除它的映射
+static void finish_eviction(BufferPoolManager* bpm, BufferPoolShard* shard, int frame_id, const Victim* victim) {
+    if (!victim->dirty) return;
+    BPM_LOG(bpm, "缓冲池: 被淘汰的 page %lld 是脏页，正在写回磁盘...\n", (long long)victim->page_id);
+    wake_flusher(bpm);
+    wal_before_write(bpm, victim->page_lsn);
+    write_page_to_disk(bpm->disk_manager, victim->page_id, bpm->pages[frame_id].data);
+    shard_lock(bpm, shard);
+    page_table_remove(shard, victim->page_id); // 从页表中移除旧页的映射
+    end_writeback(bpm, frame_id);
+    shard_unlock(bpm, shard);
+}
+
+// 页面读入完成，唤醒等待它的线程。没有被钉住的页面 (预读) 此时才变为可淘汰
+static void finish_load(BufferPoolManager* bpm, BufferPoolShard* shard, int frame_id) {
+    Page* page = &bpm->pages[frame_id];
+    shard_lock(bpm, shard);
+    page->io_pending = false;
+    if (page->pin_count == 0) {
+        replacer_set_evictable(shard->replacer, frame_id, true);
+    }
+    if (bpm->concurrent) pthread_cond_broadcast(&shard->io_done);
+    shard_unlock(bpm, shard);
+}
+
+// 取一个空闲的 AsyncIO，都在使用时返回 NULL
+static AsyncIO* take_prefetch_io(BufferPoolManager* bpm) {
+    pthread_mutex_lock(&bpm->prefetch_lock);
+    AsyncIO* aio = bpm->prefetch_io_free > 0 ? bpm->prefetch_ios[--bpm->prefetch_io_free] : NULL;
+    pthread_mutex_unlock(&bpm->prefetch_lock);
+    return aio;
+}
+
+static void put_prefetch_io(BufferPoolManager* bpm, AsyncIO* aio) {
+    pthread_mutex_lock(&bpm->prefetch_lock);
+    bpm->prefetch_ios[bpm->prefetch_io_free++] = aio;
+    pthread_mutex_unlock(&bpm->prefetch_lock);
+}
+
+// 把不在缓冲池中的页面读入空闲或可淘汰的帧，不钉住。own 不为空时它已经占好帧，
+// 和预读的页面放在同一批中一起读。不持有 prefetch_lock，各分片只在取帧时短暂加锁。返回预读的页面数
+static int read_batch(BufferPoolManager* bpm, PageIORequest* own, const page_id_t* page_ids, int n) {
+    PageIORequest requests[PREFETCH_BATCH + 1];
+    int frames[PREFETCH_BATCH + 1];
+    int count = 0;
+    if (own) {
+        requests[count] = *own;
+        frames[count++] = -1;
+    }
+
+    for (int i = 0; i < n && i < PREFETCH_BATCH; i++) {
+        page_id_t page_id = page_ids[i];
+        if (page_id < 0) continue;
+        BufferPoolShard* shard = shard_of(bpm, page_id);
+        shard_lock(bpm, shard);
+        if (page_table_find(shard, page_id) != -1) {
+            shard_unlock(bpm, shard); // 已经在缓冲池中 (或正在被读入)
+            continue;
+        }
+        Victim victim;
+        int frame_id = claim_frame(bpm, shard, page_id, NULL, 0, &victim);
+        shard_unlock(bpm, shard);
+        if (frame_id == -1) break;
+        finish_eviction(bpm, shard, frame_id, &victim);
+
+        requests[count].page_id = page_id;
+        requests[count].data = bpm->pages[frame_id].data;
+        requests[count].is_write = false;
+        requests[count].done = false;
+        frames[count++] = frame_id;
+    }
+
+    // 短读已经用 0 填充；出错或没有完成的请求改用同步读，不把帧中被淘汰页面的旧内容当作新页面发布。
+    // 所有 AsyncIO 都在使用时整批同步读
+    AsyncIO* aio = take_prefetch_io(bpm);
+    int failed = count;
+    if (aio) {
+        failed = async_io_run(aio, requests, count);
+        put_prefetch_io(bpm, aio);
+    }
+    if (failed > 0) {
+        for (int i = 0; i < count; i++) {
+            if (!requests[i].done || requests[i].result < 0) {
+                read_page_from_disk(bpm->disk_manager, requests[i].page_id, requests[i].data);
+            }
+        }
+    }
+
+    int prefetched = 0;
+    for (int i = 0; i < count; i++) {
+        if (frames[i] == -1) continue;
+        finish_load(bpm, shard_of(bpm, requests[i].page_id), frames[i]);
+        prefetched++;
+    }
+    return prefetched;
+}
+
+// 顺序访问检测: 未命中的页面紧接着上一次未命中的页面，或者正好是上一个预读窗口之后的第一页，
+// 连续 READAHEAD_TRIGGER 次后预读接下来的 readahead_pages 页。返回预读窗口的末尾 (不含)，
+// 不需要预读时返回 page_id + 1。调用前必须持有 prefetch_lock
+static page_id_t readahead_window_locked(BufferPoolManager* bpm, page_id_t page_id) {
+    bool sequential = page_id == bpm->readahead_last + 1 || page_id == bpm->readahead_next;
+    bpm->readahead_run = sequential ? bpm->readahead_run + 1 : 1;
+    bpm->readahead_last = page_id;
+
+    // 不预读还没有分配的页面
+    page_id_t end = __atomic_load_n(&bpm->disk_manager->next_page_id, __ATOMIC_RELAXED);
+    // 缓冲池缩小后窗口也跟着缩小，不超过当前帧数的四分之一
+    int window = bpm->readahead_pages;
+    int pool_size = __atomic_load_n(&bpm->pool_size, __ATOMIC_RELAXED);
+    if (window > pool_size / 4) window = pool_size / 4;
+    if (end > page_id + 1 + window) end = page_id + 1 + window;
+    if (bpm->readahead_run < READAHEAD_TRIGGER || end <= page_id + 1) {
+        return page_id + 1;
+    }
+    bpm->readahead_next = end;
+    BPM_LOG(bpm, "缓冲池: 检测到顺序访问，预读 page %lld 到 %lld.\n", (long long)page_id + 1, (long long)end - 1);
+    return end;
+}
+
+// 预读的页面和当前页面放在同一批中读入。返回 true 表示当前页面已经随预读一起读入
+static bool maybe_readahead(BufferPoolManager* bpm, page_id_t page_id, char* data) {
+    if (bpm->readahead_pages <= 0) return false;
+    pthread_mutex_lock(&bpm->prefetch_lock);
+    page_id_t end = readahead_window_locked(bpm, page_id);
+    pthread_mutex_unlock(&bpm->prefetch_lock);
+    if (end <= page_id + 1) return false;
+
+    page_id_t page_ids[PREFETCH_BATCH];
+    int n = 0;
+    for (page_id_t id = page_id + 1; id < end; id++) {
+        page_ids[n++] = id;
+    }
+
+    PageIORequest own = { .page_id = page_id, .data = data, .is_write = false };
+    read_batch(bpm, &own, page_ids, n);
+    return true;
+}
+
+// 映射模式下的预读: 不占用帧，只提示内核把后面的页面读进页缓存
+static void maybe_readahead_view(BufferPoolManager* bpm, page_id_t page_id) {
+    if (bpm->readahead_pages <= 0) return;
+    pthread_mutex_lock(&bpm->prefetch_lock);
+    page_id_t end = readahead_window_locked(bpm, page_id);
+    pthread_mutex_unlock(&bpm->prefetch_lock);
+    if (end > page_id + 1) {
+        disk_manager_willneed(bpm->disk_manager, page_id + 1, end - page_id - 1);
+    }
+}
+
+// 页面的取用方式
+typedef enum FetchMode {
+    FETCH_READ,                 // 读入帧中，可以修改
+    FETCH_NEW,                  // 刚分配的页面 (可能是被释放后重新分配的)，未命中时不读盘，直接清零
+    FETCH_VIEW                  // 只读，数据文件已映射时直接使用映射中的页面
+} FetchMode;
 
-    // 3. 加载新页面到获取到的帧中
-    read_page_from_disk(bpm->disk_manager, page_id, bpm->pages[frame_id].data);
-    bpm->pages[frame_id].page_id = page_id;
-    bpm->pages[frame_id].pin_count = 1;
-    bpm->pages[frame_id].is_dirty = false;
-    
-    // 更新页表
-    bpm->page_table[page_id] = frame_id;
-    
-    // 从LRU淘汰队列中移除（因为它刚被访问）
-    lru_replacer_pin(bpm, frame_id);
+static Page* fetch_page_impl(BufferPoolManager* bpm, page_id_t page_id, BufferAccessStrategy* strategy, FetchMode mode) {
+    if (page_id < 0) {
+        BPM_LOG(bpm, "缓冲池: 错误! 无效的 page %lld.\n", (long long)page_id);
+        return NULL;
+    }
+    BufferPoolShard* shard = shard_of(bpm, page_id);
+    shard_lock(bpm, shard);
+
+    // 1. 在页表中查找页面 (缓存命中)
+    int frame_id;
+    while ((frame_id = page_table_find(shard, page_id)) != -1) {
+        Page* page = &bpm->pages[frame_id];
+        if (!page->io_pending) {
+            BPM_LOG(bpm, "缓冲池: 缓存命中 page %lld (在 frame %d).\n", (long long)page_id, frame_id);
+            if (page->mapped && mode != FETCH_VIEW) {
+                // 要修改只读视图中的页面时先复制到帧自己的缓冲区。
+                // 已经拿到视图的读者继续读映射，内容在复制的这一刻是一样的
+                char* buffer = bpm->frame_data + (size_t)frame_id * bpm->page_size;
+                memcpy(buffer, page->data, bpm->page_size);
+                page->data = buffer;
+                page->mapped = false;
+            }
+            page->pin_count++;
+            replacer_record_access(shard->replacer, frame_id, page_id);
+            replacer_set_evictable(shard->replacer, frame_id, false); // 被钉住的页面不能被淘汰
+            shard_unlock(bpm, shard);
+            return page;
+        }
+        // 其他线程正在读入这个页面 (或把它从帧中写回)，等待完成后重新查找，避免重复读盘
+        shard_wait_io(bpm, shard);
+    }
 
-    return &bpm->pages[frame_id];
+    // 2. 缓存未命中，需要从磁盘加载
+    BPM_LOG(bpm, "缓冲池: 缓存未命中 page %lld. 尝试加载...\n", (long long)page_id);
+    Victim victim;
+    frame_id = claim_frame(bpm, shard, page_id, strategy, 1, &victim);
+    shard_unlock(bpm, shard);
+    if (frame_id == -1) {
+        return NULL;
+    }
+    finish_eviction(bpm, shard, frame_id, &victim);
+
+    // 3. 加载新页面到获取到的帧中 (顺序访问时和预读的页面一起读入)。
+    // 只读访问且页面在映射中时不复制，帧直接指向映射。
+    // 使用访问策略时不预读: 预读的页面不从策略的环中取帧，会把热点页面挤出缓冲池
+    Page* page = &bpm->pages[frame_id];
+    const char* view = mode == FETCH_VIEW ? disk_manager_view(bpm->disk_manager, page_id) : NULL;
+    if (mode == FETCH_NEW) {
+        memset(page->data, 0, bpm->page_size);
+    } else if (view) {
+        page->data = (char*)view;
+        page->mapped = true;
+        maybe_readahead_view(bpm, page_id);
+    } else if (strategy != NULL || !maybe_readahead(bpm, page_id, page->data)) {
+        read_page_from_disk(bpm->disk_manager, page_id, page->data);
+    }
+    finish_load(bpm, shard, frame_id);
+    return page;
+}
+
+Page* fetch_page(BufferPoolManager* bpm, page_id_t page_id) {
+    return fetch_page_impl(bpm, page_id, NULL, FETCH_READ);
+}
+
+Page* fetch_page_read_only(BufferPoolManager* bpm, page_id_t page_id) {
+    return fetch_page_impl(bpm, page_id, NULL, FETCH_VIEW);
+}
+
+// 已经在缓冲池中的页面照常命中；未命中时只在策略自己的环中循环使用帧
+Page* fetch_page_with_strategy(BufferPoolManager* bpm, page_id_t page_id, BufferAccessStrategy* strategy) {
+    return fetch_page_impl(bpm, page_id, strategy, FETCH_READ);
 }
 
 bool unpin_page(BufferPoolManager* bpm, page_id_t page_id, bool is_dirty) {
-    if (bpm->page_table[page_id] == INVALID_PAGE_ID) {
+    BufferPoolShard* shard = shard_of(bpm, page_id);
+    shard_lock(bpm, shard);
+    int frame_id = page_table_find(shard, page_id);
+    // 写回期间旧页的映射还指向这个帧，但帧里已经是新页了
+    if (frame_id == -1 || bpm->pages[frame_id].page_id != page_id) {
+        shard_unlock(bpm, shard);
         return false; // 页面不在缓冲池中
     }
-    int frame_id = bpm->page_table[page_id];
-    if (bpm->pages[frame_id].pin_count <= 0) {
+    Page* page = &bpm->pages[frame_id];
+    if (page->pin_count <= 0) {
+        shard_unlock(bpm, shard);
         return false; // pin_count 已经为0
     }
 
-    bpm->pages[frame_id].pin_count--;
-    if (is_dirty) {
-        bpm->pages[frame_id].is_dirty = true;
+    page->pin_count--;
+    if (is_dirty && page->mapped) {
+        BPM_LOG(bpm, "缓冲池: 错误! page %lld 是只读视图，不能标记为脏页.\n", (long long)page_id);
+    } else if (is_dirty) {
+        page->is_dirty = true;
     }
 
-    // 如果 pin_count 降为0，则该页可以被淘汰，将其加入LRU队列
-    if (bpm->pages[frame_id].pin_count == 0) {
-        lru_replacer_unpin(bpm, frame_id);
+    // 如果 pin_count 降为0，则该页可以被淘汰
+    if (page->pin_count == 0) {
+        replacer_set_evictable(shard->replacer, frame_id, true);
+        // 缩小缓冲池的线程在等这个帧
+        if (frame_id == shard->retiring_frame && bpm->concurrent) pthread_cond_broadcast(&shard->io_done);
     }
+    shard_unlock(bpm, shard);
     return true;
 }
 
+int prefetch_pages(BufferPoolManager* bpm, const page_id_t* page_ids, int n) {
+    int prefetched = 0;
+    for (int i = 0; i < n; i += PREFETCH_BATCH) {
+        int count = n - i < PREFETCH_BATCH ? n - i : PREFETCH_BATCH;
+        prefetched += read_batch(bpm, NULL, page_ids + i, count);
+    }
+    return prefetched;
+}
+
 Page* new_page(BufferPoolManager* bpm, page_id_t* new_page_id) {
     *new_page_id = allocate_page_on_disk(bpm->disk_manager);
-    // fetch_page 会处理缓存未命中、淘汰和加载的逻辑
-    return fetch_page(bpm, *new_page_id);
+    if (*new_page_id == INVALID_PAGE_ID) return NULL;
+    // fetch_page 会处理缓存未命中和淘汰的逻辑；新页面不需要读盘
+    Page* page = fetch_page_impl(bpm, *new_page_id, NULL, FETCH_NEW);
+    if (page == NULL) {
+        deallocate_page_on_disk(bpm->disk_manager, *new_page_id); // 没有可用的帧，页号还回去
+    }
+    return page;
+}
+
+bool delete_page(BufferPoolManager* bpm, page_id_t page_id) {
+    if (page_id < 0) return false;
+    BufferPoolShard* shard = shard_of(bpm, page_id);
+    shard_lock(bpm, shard);
+    int frame_id;
+    while ((frame_id = page_table_find(shard, page_id)) != -1 && bpm->pages[frame_id].io_pending) {
+        shard_wait_io(bpm, shard);
+    }
+    if (frame_id != -1) {
+        Page* page = &bpm->pages[frame_id];
+        if (page->pin_count > 0) {
+            shard_unlock(bpm, shard);
+            BPM_LOG(bpm, "缓冲池: 错误! page %lld 仍被钉住，无法删除.\n", (long long)page_id);
+            return false;
+        }
+        // 页面内容作废，不需要写回；帧直接还给空闲列表
+        page_table_remove(shard, page_id);
+        replacer_remove(shard->replacer, frame_id);
+        reset_frame(bpm, frame_id);
+        shard->free_list[shard->free_list_size++] = frame_id;
+    }
+    shard_unlock(bpm, shard);
+    BPM_LOG(bpm, "缓冲池: 删除 page %lld.\n", (long long)page_id);
+    return deallocate_page_on_disk(bpm->disk_manager, page_id);
+}
+
+
+// --- 调整缓冲池大小 ---
+
+// 从空闲列表中取出 frame_id，不在列表中时返回 false。调用前必须持有分片锁
+static bool free_list_take(BufferPoolShard* shard, int frame_id) {
+    for (int i = 0; i < shard->free_list_size; i++) {
+        if (shard->free_list[i] == frame_id) {
+            shard->free_list[i] = shard->free_list[--shard->free_list_size];
+            return true;
+        }
+    }
+    return false;
+}
+
+// 从空闲列表中取一个编号小于 limit 的帧 (缩小后仍然在用的帧)，没有时返回 -1
+static int free_list_take_below(BufferPoolShard* shard, int limit) {
+    for (int i = shard->free_list_size - 1; i >= 0; i--) {
+        int frame_id = shard->free_list[i];
+        if (frame_id < limit) {
+            shard->free_list[i] = shard->free_list[--shard->free_list_size];
+            return frame_id;
+        }
+    }
+    return -1;
+}
+
+// 把分片中最后一个在用的帧腾空并移出。帧中的页面优先迁移到留下的空闲帧，
+// 没有空闲帧时淘汰，脏页先写回。调用前必须持有分片锁，返回时仍持有 (写回和等待时会暂时放开)。
+// 返回 false 表示页面被钉住而非并发模式下等不到它被 unpin
+static bool retire_last_frame(BufferPoolManager* bpm, BufferPoolShard* shard) {
+    int frame_id = shard->frame_begin + shard->frame_count - 1;
+    Page* page = &bpm->pages[frame_id];
+    for (;;) {
+        if (page->page_id == INVALID_PAGE_ID) {
+            free_list_take(shard, frame_id);
+            break;
+        }
+        if (page->io_pending) {
+            shard_wait_io(bpm, shard);
+            continue;
+        }
+        if (page->pin_count > 0) {
+            if (!bpm->concurrent) return false;
+            // pin_count 降为 0 时 unpin_page 广播 io_done
+            shard->retiring_frame = frame_id;
+            shard_wait_io(bpm, shard);
+            shard->retiring_frame = -1;
+            continue;
+        }
+
+        page_id_t page_id = page->page_id;
+        replacer_remove(shard->replacer, frame_id);
+        int target = free_list_take_below(shard, frame_id);
+        if (target != -1) {
+            // 迁移: 内容、脏标记和 LSN 一起搬到留下的空闲帧，缓存的页面不会丢
+            Page* dest = &bpm->pages[target];
+            if (page->mapped) {
+                dest->data = page->data;
+                dest->mapped = true;
+            } else {
+                dest->data = bpm->frame_data + (size_t)target * bpm->page_size;
+                dest->mapped = false;
+                memcpy(dest->data, page->data, bpm->page_size);
+            }
+            dest->page_id = page_id;
+            dest->is_dirty = page->is_dirty;
+            dest->page_lsn = page->page_lsn;
+            dest->rec_lsn = page->rec_lsn;
+            page_table_remove(shard, page_id);
+            page_table_insert(shard, page_id, target);
+            replacer_record_access(shard->replacer, target, page_id);
+            replacer_set_evictable(shard->replacer, target, true);
+            BPM_LOG(bpm, "缓冲池: page %lld 从 frame %d 迁移到 frame %d.\n", (long long)page_id, frame_id, target);
+            break;
+        }
+
+        // 没有空闲帧时淘汰。写回期间保留映射并标记 io_pending，访问它的线程等写完后从磁盘重新读入
+        BPM_LOG(bpm, "缓冲池: 淘汰 frame %d 中的 page %lld.\n", frame_id, (long long)page_id);
+        if (page->is_dirty) {
+            page->io_pending = true;
+            page->is_dirty = false;
+            begin_writeback(bpm, frame_id, page_id);
+            lsn_t page_lsn = page->page_lsn;
+            shard_unlock(bpm, shard);
+            wal_before_write(bpm, page_lsn);
+            write_page_to_disk(bpm->disk_manager, page_id, page->data);
+            shard_lock(bpm, shard);
+            end_writeback(bpm, frame_id);
+            if (bpm->concurrent) pthread_cond_broadcast(&shard->io_done);
+        }
+        page_table_remove(shard, page_id);
+        break;
+    }
+    reset_frame(bpm, frame_id);
+    __atomic_store_n(&shard->frame_count, shard->frame_count - 1, __ATOMIC_RELAXED); // 刷盘时不加锁读取
+    return true;
+}
+
+bool resize_buffer_pool(BufferPoolManager* bpm, int new_pool_size) {
+    if (new_pool_size < bpm->num_shards || new_pool_size > bpm->frame_capacity) {
+        fprintf(stderr, "缓冲池: 错误! 帧数必须在 %d 到 %d 之间.\n", bpm->num_shards, bpm->frame_capacity);
+        return false;
+    }
+    pthread_mutex_lock(&bpm->resize_lock);
+    bool ok = true;
+    int pool_size = 0;
+    for (int s = 0; s < bpm->num_shards; s++) {
+        BufferPoolShard* shard = &bpm->shards[s];
+        int target = new_pool_size / bpm->num_shards + (s < new_pool_size % bpm->num_shards ? 1 : 0);
+        shard_lock(bpm, shard);
+        // 扩大: 预留的帧直接加入空闲列表
+        while (shard->frame_count < target) {
+            shard->free_list[shard->free_list_size++] = shard->frame_begin + shard->frame_count;
+            __atomic_store_n(&shard->frame_count, shard->frame_count + 1, __ATOMIC_RELAXED);
+        }
+        // 缩小: 从后往前逐帧移出
+        int old_count = shard->frame_count;
+        while (ok && shard->frame_count > target) {
+            ok = retire_last_frame(bpm, shard);
+        }
+        int frame_count = shard->frame_count;
+        shard_unlock(bpm, shard);
+        pool_size += frame_count;
+
+        // 移出的帧缓冲区还给操作系统，再次扩大时重新分配的是清零的内存
+        if (frame_count < old_count) {
+            madvise(bpm->frame_data + (size_t)(shard->frame_begin + frame_count) * bpm->page_size,
+                    (size_t)(old_count - frame_count) * bpm->page_size, MADV_DONTNEED);
+        }
+    }
+    __atomic_store_n(&bpm->pool_size, pool_size, __ATOMIC_RELAXED); // 预读时不加锁读取
+    BPM_LOG(bpm, "缓冲池: 帧数调整为 %d.\n", pool_size);
+    pthread_mutex_unlock(&bpm->resize_lock);
+    return ok;
+}
+
+
+// 批量刷盘的一项
+typedef struct FlushEntry {
+    page_id_t page_id;
+    int frame_id;
+    BufferPoolShard* shard;
+    char* snapshot;             // 写回的是这份快照，不是帧本身
+} FlushEntry;
+
+// 页面只在被钉住时修改。没有被钉住的页面在分片锁下复制出的快照和它的 page_lsn 是一致的；
+// 并发模式下被钉住的页面可能正被其他线程修改，不能写回。非并发模式下只有调用者一个线程，
+// 写盘期间不会有修改。调用前必须持有分片锁
+static inline bool page_stable(const BufferPoolManager* bpm, const Page* page) {
+    return !bpm->concurrent || page->pin_count == 0;
+}
+
+// 写回用的快照缓冲区，按 DIRECT_IO_ALIGN 对齐，直接 I/O 时不需要再中转
+static char* alloc_snapshots(const BufferPoolManager* bpm, int pages) {
+    void* buffer = NULL;
+    if (posix_memalign(&buffer, DIRECT_IO_ALIGN, (size_t)pages * bpm->page_size) != 0) return NULL;
+    return (char*)buffer;
 }
 
 bool flush_page(BufferPoolManager* bpm, page_id_t page_id) {
-    if (bpm->page_table[page_id] == INVALID_PAGE_ID) {
+    char* snapshot = alloc_snapshots(bpm, 1);
+    if (snapshot == NULL) return false;
+    BufferPoolShard* shard = shard_of(bpm, page_id);
+    shard_lock(bpm, shard);
+    int frame_id;
+    while ((frame_id = page_table_find(shard, page_id)) != -1 && bpm->pages[frame_id].io_pending) {
+        shard_wait_io(bpm, shard);
+    }
+    if (frame_id == -1) {
+        shard_unlock(bpm, shard);
+        free(snapshot);
+        return false;
+    }
+
+    // 只读视图就是磁盘上的内容，不需要写
+    Page* page = &bpm->pages[frame_id];
+    if (page->mapped) {
+        shard_unlock(bpm, shard);
+        free(snapshot);
+        return true;
+    }
+    if (!page_stable(bpm, page)) {
+        shard_unlock(bpm, shard);
+        free(snapshot);
+        BPM_LOG(bpm, "缓冲池: page %lld 被钉住，暂不刷盘.\n", (long long)page_id);
         return false;
     }
-    int frame_id = bpm->page_table[page_id];
-    write_page_to_disk(bpm->disk_manager, page_id, bpm->pages[frame_id].data);
-    bpm->pages[frame_id].is_dirty = false;
-    printf("缓冲池: 已将 page %d (在 frame %d) 刷新到磁盘.\n", page_id, frame_id);
+
+    // 写的是快照，写盘期间其他线程可以照常修改页面。写盘期间钉住页面防止被淘汰；
+    // 先清脏标记，之后的修改会重新标脏
+    memcpy(snapshot, page->data, bpm->page_size);
+    page->pin_count++;
+    replacer_set_evictable(shard->replacer, frame_id, false);
+    page->is_dirty = false;
+    begin_writeback(bpm, frame_id, page_id);
+    lsn_t page_lsn = page->page_lsn;
+    shard_unlock(bpm, shard);
+
+    wal_before_write(bpm, page_lsn);
+    write_page_to_disk(bpm->disk_manager, page_id, snapshot);
+    free(snapshot);
+    BPM_LOG(bpm, "缓冲池: 已将 page %lld (在 frame %d) 刷新到磁盘.\n", (long long)page_id, frame_id);
+
+    shard_lock(bpm, shard);
+    end_writeback(bpm, frame_id);
+    if (--page->pin_count == 0) {
+        replacer_set_evictable(shard->replacer, frame_id, true);
+    }
+    shard_unlock(bpm, shard);
     return true;
 }
 
-void flush_all_pages(BufferPoolManager* bpm) {
-    printf("缓冲池: 正在刷新所有脏页到磁盘...\n");
-    for (int i = 0; i < BUFFER_POOL_SIZE; i++) {
-        if (bpm->pages[i].page_id != INVALID_PAGE_ID && bpm->pages[i].is_dirty) {
-            flush_page(bpm, bpm->pages[i].page_id);
+static int compare_flush_entries(const void* a, const void* b) {
+    page_id_t x = ((const FlushEntry*)a)->page_id;
+    page_id_t y = ((const FlushEntry*)b)->page_id;
+    return (x > y) - (x < y);
+}
+
+// 把一批脏页按 page_id 排序，页号连续的合并成一次向量写。
+// 在分片锁下把页面复制成快照再写，写盘期间其他线程可以照常钉住和修改页面；
+// 被钉住 (可能正在修改) 的页面留给下一轮。写盘期间仍钉住页面防止被淘汰，
+// 否则干净的页面被换出后会从磁盘读到还没写完的旧内容。先清脏标记，之后的修改会重新标脏。
+// 整批只需要把日志刷到快照中最大的 page_lsn。返回写出的页数
+static int flush_entries(BufferPoolManager* bpm, FlushEntry* entries, int n) {
+    if (n == 0) return 0;
+    char* snapshots = alloc_snapshots(bpm, n);
+    if (snapshots == NULL) return 0;
+    int count = 0;
+    lsn_t max_lsn = INVALID_LSN;
+    for (int i = 0; i < n; i++) {
+        FlushEntry* entry = &entries[i];
+        Page* page = &bpm->pages[entry->frame_id];
+        shard_lock(bpm, entry->shard);
+        // 收集之后页面可能已经被刷盘、被换出或被钉住
+        if (page->page_id == entry->page_id && page->is_dirty && !page->io_pending && page_stable(bpm, page)) {
+            entry->snapshot = snapshots + (size_t)count * bpm->page_size;
+            memcpy(entry->snapshot, page->data, bpm->page_size);
+            page->pin_count++;
+            replacer_set_evictable(entry->shard->replacer, entry->frame_id, false);
+            page->is_dirty = false;
+            begin_writeback(bpm, entry->frame_id, entry->page_id);
+            if (page->page_lsn > max_lsn) max_lsn = page->page_lsn;
+            entries[count++] = *entry;
+        }
+        shard_unlock(bpm, entry->shard);
+    }
+    wal_before_write(bpm, max_lsn);
+
+    qsort(entries, count, sizeof(FlushEntry), compare_flush_entries);
+    char* run[FLUSH_BATCH];
+    for (int start = 0; start < count; ) {
+        int end = start;
+        while (end < count && entries[end].page_id == entries[start].page_id + (end - start)) {
+            run[end - start] = entries[end].snapshot;
+            end++;
+        }
+        write_pages_to_disk(bpm->disk_manager, entries[start].page_id, run, end - start);
+        start = end;
+    }
+
+    for (int i = 0; i < count; i++) {
+        FlushEntry* entry = &entries[i];
+        Page* page = &bpm->pages[entry->frame_id];
+        BPM_LOG(bpm, "缓冲池: 已将 page %lld (在 frame %d) 刷新到磁盘.\n", (long long)entry->page_id, entry->frame_id);
+        shard_lock(bpm, entry->shard);
+        end_writeback(bpm, entry->frame_id);
+        if (--page->pin_count == 0) {
+            replacer_set_evictable(entry->shard->replacer, entry->frame_id, true);
+        }
+        shard_unlock(bpm, entry->shard);
+    }
+    free(snapshots);
+    return count;
+}
+
+// 分批收集并写回脏页。older_than 不是 INVALID_LSN 时只写回 rec_lsn 早于它的页面。
+// 并发模式下跳过被钉住的页面，它们留在脏页表中，检查点照常记录
+static int flush_dirty_pages(BufferPoolManager* bpm, lsn_t older_than) {
+    FlushEntry entries[FLUSH_BATCH];
+    int n = 0;
+    int flushed = 0;
+    for (int s = 0; s < bpm->num_shards; s++) {
+        BufferPoolShard* shard = &bpm->shards[s];
+        // 调整缓冲池大小时 frame_count 会变，每次循环重新读取
+        for (int i = shard->frame_begin; i < shard->frame_begin + __atomic_load_n(&shard->frame_count, __ATOMIC_RELAXED); i++) {
+            shard_lock(bpm, shard);
+            Page* page = &bpm->pages[i];
+            lsn_t rec_lsn = __atomic_load_n(&page->rec_lsn, __ATOMIC_SEQ_CST);
+            if (page->page_id != INVALID_PAGE_ID && page->is_dirty && !page->io_pending && page_stable(bpm, page) &&
+                (older_than == INVALID_LSN || (rec_lsn != INVALID_LSN && rec_lsn < older_than))) {
+                entries[n].page_id = page->page_id;
+                entries[n].frame_id = i;
+                entries[n].shard = shard;
+                n++;
+            }
+            shard_unlock(bpm, shard);
+            if (n == FLUSH_BATCH) {
+                flushed += flush_entries(bpm, entries, n);
+                n = 0;
+            }
         }
     }
+    return flushed + flush_entries(bpm, entries, n);
 }
 
+void flush_all_pages(BufferPoolManager* bpm) {
+    BPM_LOG(bpm, "缓冲池: 正在刷新所有脏页到磁盘...\n");
+    flush_dirty_pages(bpm, INVALID_LSN);
+}
 
-// --- LRU Replacer 实现 ---
+int flush_pages_older_than(BufferPoolManager* bpm, lsn_t lsn) {
+    if (lsn == INVALID_LSN) return 0;
+    return flush_dirty_pages(bpm, lsn);
+}
 
-// 当一个页面被访问时，它不能被淘汰，从LRU队列中移除
-void lru_replacer_pin(BufferPoolManager* bpm, int frame_id) {
-    bpm->lru_in_replacer[frame_id] = false;
+int collect_dirty_pages(BufferPoolManager* bpm, DirtyPageEntry** entries) {
+    // 每帧最多一个脏页加一个正在写回的页面
+    *entries = (DirtyPageEntry*)malloc(2 * bpm->frame_capacity * sizeof(DirtyPageEntry));
+    int count = 0;
+    for (int s = 0; s < bpm->num_shards; s++) {
+        BufferPoolShard* shard = &bpm->shards[s];
+        shard_lock(bpm, shard);
+        for (int i = shard->frame_begin; i < shard->frame_begin + shard->frame_count; i++) {
+            Page* page = &bpm->pages[i];
+            lsn_t rec_lsn = __atomic_load_n(&page->rec_lsn, __ATOMIC_SEQ_CST);
+            if (page->page_id != INVALID_PAGE_ID && rec_lsn != INVALID_LSN) {
+                (*entries)[count].page_id = page->page_id;
+                (*entries)[count].rec_lsn = rec_lsn;
+                count++;
+            }
+            if (bpm->writebacks[i].page_id != INVALID_PAGE_ID && bpm->writebacks[i].rec_lsn != INVALID_LSN) {
+                (*entries)[count++] = bpm->writebacks[i];
+            }
+        }
+        shard_unlock(bpm, shard);
+    }
+    return count;
 }
 
-// 当一个页面pin_count降为0时，它可以被淘汰，加入LRU队列末尾
-void lru_replacer_unpin(BufferPoolManager* bpm, int frame_id) {
-    if (!bpm->lru_in_replacer[frame_id]) {
-        bpm->lru_replacer[bpm->lru_tail] = frame_id;
-        bpm->lru_tail = (bpm->lru_tail + 1) % BUFFER_POOL_SIZE;
-        bpm->lru_in_replacer[frame_id] = true;
+
+// --- 后台刷盘线程 ---
+
+// 统计干净的可用帧 (空闲帧和未被钉住的干净页面)，不够 flusher_clean_target 时
+// 从分片中挑出未被钉住的脏页批量写回。返回写出的页数
+static int flusher_pass(BufferPoolManager* bpm) {
+    FlushEntry entries[FLUSH_BATCH];
+    int n = 0;
+    int clean = 0;
+    for (int s = 0; s < bpm->num_shards; s++) {
+        BufferPoolShard* shard = &bpm->shards[s];
+        shard_lock(bpm, shard);
+        clean += shard->free_list_size;
+        for (int i = shard->frame_begin; i < shard->frame_begin + shard->frame_count; i++) {
+            Page* page = &bpm->pages[i];
+            if (page->page_id == INVALID_PAGE_ID || page->pin_count > 0 || page->io_pending) continue;
+            if (!page->is_dirty) {
+                clean++;
+            } else if (n < FLUSH_BATCH) {
+                entries[n].page_id = page->page_id;
+                entries[n].frame_id = i;
+                entries[n].shard = shard;
+                n++;
+            }
+        }
+        shard_unlock(bpm, shard);
     }
+    if (clean >= bpm->flusher_clean_target) return 0;
+
+    int need = bpm->flusher_clean_target - clean;
+    return flush_entries(bpm, entries, n < need ? n : need);
 }
 
-// 从LRU队列头部取出一个可淘汰的页面
-bool lru_replacer_evict(BufferPoolManager* bpm, int* frame_id) {
-    int current_head = bpm->lru_head;
-    while (current_head != bpm->lru_tail) {
-        int candidate_frame = bpm->lru_replacer[current_head];
-        // 再次确认该帧是否在等待被淘汰
-        if (bpm->lru_in_replacer[candidate_frame]) {
-            *frame_id = candidate_frame;
-            bpm->lru_head = (current_head + 1) % BUFFER_POOL_SIZE;
-            bpm->lru_in_replacer[candidate_frame] = false;
-            return true;
+static int64_t monotonic_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static void* flusher_main(void* arg) {
+    BufferPoolManager* bpm = (BufferPoolManager*)arg;
+    int interval_ms = bpm->flusher_interval_ms > 0 ? bpm->flusher_interval_ms : bpm->checkpoint_interval_ms;
+    int64_t next_checkpoint = monotonic_ms() + bpm->checkpoint_interval_ms;
+    pthread_mutex_lock(&bpm->flusher_lock);
+    while (bpm->flusher_running) {
+        pthread_mutex_unlock(&bpm->flusher_lock);
+        // 一轮写满一批时说明脏页很多，不等待直接进行下一轮
+        int written = bpm->flusher_interval_ms > 0 ? flusher_pass(bpm) : 0;
+        if (bpm->checkpoint_interval_ms > 0 && monotonic_ms() >= next_checkpoint) {
+            take_checkpoint(bpm, bpm->wal);
+            next_checkpoint = monotonic_ms() + bpm->checkpoint_interval_ms;
+        }
+        pthread_mutex_lock(&bpm->flusher_lock);
+        if (written == FLUSH_BATCH || !bpm->flusher_running) continue;
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += interval_ms / 1000;
+        deadline.tv_nsec += (long)(interval_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
         }
-        current_head = (current_head + 1) % BUFFER_POOL_SIZE;
+        pthread_cond_timedwait(&bpm->flusher_wake, &bpm->flusher_lock, &deadline);
+    }
+    pthread_mutex_unlock(&bpm->flusher_lock);
+    return NULL;
+}
+
+// 前台线程不得不自己写回脏页时叫醒刷盘线程，尽快补充干净的帧
+static void wake_flusher(BufferPoolManager* bpm) {
+    if (!bpm->flusher_started) return;
+    pthread_mutex_lock(&bpm->flusher_lock);
+    pthread_cond_signal(&bpm->flusher_wake);
+    pthread_mutex_unlock(&bpm->flusher_lock);
+}
+
+
+// --- 访问策略实现 ---
+
+BufferAccessStrategy* create_access_strategy(BufferPoolManager* bpm, AccessStrategyType type) {
+    BufferAccessStrategy* strategy = (BufferAccessStrategy*)malloc(sizeof(BufferAccessStrategy));
+    strategy->type = type;
+    // 环最多占缓冲池的 1/8，再平均分到各个分片，每个分片至少一帧
+    int ring_size = type == ACCESS_BULK_WRITE ? BULK_WRITE_RING_SIZE : BULK_READ_RING_SIZE;
+    if (ring_size > bpm->pool_size / 8) ring_size = bpm->pool_size / 8;
+    strategy->ring_per_shard = ring_size / bpm->num_shards > 0 ? ring_size / bpm->num_shards : 1;
+
+    int slots = bpm->num_shards * strategy->ring_per_shard;
+    strategy->ring_frames = (int*)malloc(slots * sizeof(int));
+    strategy->ring_pages = (page_id_t*)malloc(slots * sizeof(page_id_t));
+    strategy->ring_next = (int*)calloc(bpm->num_shards, sizeof(int));
+    for (int i = 0; i < slots; i++) {
+        strategy->ring_frames[i] = -1;
+        strategy->ring_pages[i] = INVALID_PAGE_ID;
+    }
+    return strategy;
+}
+
+void destroy_access_strategy(BufferAccessStrategy* strategy) {
+    if (strategy) {
+        free(strategy->ring_frames);
+        free(strategy->ring_pages);
+        free(strategy->ring_next);
+        free(strategy);
     }
-    return false; // 没有可淘汰的页面
 }
 
+
+// --- 页表实现 (线性探测哈希表) ---
+// 每个分片一张，调用前必须持有分片锁
+
+// 乘法哈希，把连续的页号打散到各个槽位
+static inline int page_table_slot(BufferPoolShard* shard, page_id_t page_id) {
+    uint64_t h = (uint64_t)page_id * 0x9E3779B97F4A7C15ull;
+    return (int)(h >> 32) & shard->page_table_mask;
+}
+
+// 返回 page_id 所在的 frame_id，不在缓冲池中时返回 -1
+int page_table_find(BufferPoolShard* shard, page_id_t page_id) {
+    for (int i = page_table_slot(shard, page_id); ; i = (i + 1) & shard->page_table_mask) {
+        PageTableEntry* entry = &shard->page_table[i];
+        if (entry->page_id == page_id) return entry->frame_id;
+        if (entry->page_id == INVALID_PAGE_ID) return -1;
+    }
+}
+
+// 调用者保证 page_id 不在表中。槽位数大于可能的映射数，一定有空槽
+void page_table_insert(BufferPoolShard* shard, page_id_t page_id, int frame_id) {
+    int i = page_table_slot(shard, page_id);
+    while (shard->page_table[i].page_id != INVALID_PAGE_ID) {
+        i = (i + 1) & shard->page_table_mask;
+    }
+    shard->page_table[i].page_id = page_id;
+    shard->page_table[i].frame_id = frame_id;
+}
+
+// 删除后把同一探测链上后面的项往前移，不留墓碑，查找长度不会随淘汰次数变长
+void page_table_remove(BufferPoolShard* shard, page_id_t page_id) {
+    int mask = shard->page_table_mask;
+    int hole = page_table_slot(shard, page_id);
+    while (shard->page_table[hole].page_id != page_id) {
+        if (shard->page_table[hole].page_id == INVALID_PAGE_ID) return;
+        hole = (hole + 1) & mask;
+    }
+
+    for (int i = (hole + 1) & mask; shard->page_table[i].page_id != INVALID_PAGE_ID; i = (i + 1) & mask) {
+        int home = page_table_slot(shard, shard->page_table[i].page_id);
+        // home 在 (hole, i] 之间 (环形) 时这一项留在原处，否则移到空洞
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            shard->page_table[hole] = shard->page_table[i];
+            hole = i;
+        }
+    }
+    shard->page_table[hole].page_id = INVALID_PAGE_ID;
+}
@@ -10,73 +10,292 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
 
 // --- 常量定义 ---
 
-#define PAGE_SIZE 4096              // 每个页面的大小 (4KB)
-#define BUFFER_POOL_SIZE 10         // 缓冲池中可以容纳的页面数量
+#define PAGE_SIZE 4096              // 默认的页面大小 (4KB)
+#define MIN_PAGE_SIZE 4096          // 页面大小在创建表空间时选定，是 MIN_PAGE_SIZE 到 MAX_PAGE_SIZE 之间的 2 的幂
+#define MAX_PAGE_SIZE 65536
+#define BUFFER_POOL_SIZE 10         // 缓冲池默认可以容纳的页面数量
 #define INVALID_PAGE_ID -1          // 无效页面ID的标记
+#define READAHEAD_PAGES 16          // 默认预读窗口 (页)
+#define READAHEAD_TRIGGER 3         // 连续顺序未命中多少次后开始预读
+#define PREFETCH_BATCH 64           // 一批预读 I/O 的最大页数
+#define PREFETCH_IO_MAX 8           // 并发模式下同时进行的预读批次上限 (各用一个 AsyncIO)
+#define FLUSH_BATCH 64              // 一批刷盘的最大页数
+#define WRITE_COALESCE_MAX 64       // 一次 pwritev 合并的最大页数
+#define EXTENT_PAGES 64             // 数据文件每次用 fallocate 预留的页数 (256KB)
+#define FSM_HEADER_SIZE 64          // 空闲空间映射文件头: 魔数、下一个待分配的页号和页面大小
+#define MAX_TABLESPACE_FILES 16     // 一个表空间最多的数据文件数
+#define DIRECT_IO_ALIGN 4096        // O_DIRECT 要求缓冲区、偏移和长度按这个大小对齐
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024) // 帧缓冲区按大页对齐 (2MB)
 
-// 【已修正】添加了缺失的常量定义
-// 这个常量定义了页表(page_table)可以管理的最大页面数量，
-// 决定了数据库文件的理论最大尺寸 (TABLE_MAX_PAGES * PAGE_SIZE)
-#define TABLE_MAX_PAGES 100
+// 页表是开放寻址的哈希表，每个分片一张，槽位数取大于分片帧数两倍的 2 的幂。
+// 页表大小只和缓冲池大小有关，与数据库文件大小无关
 
 // --- 数据结构定义 ---
 
-// 页面ID类型 (通常是整数)
-typedef int32_t page_id_t;
+// 页面ID类型 (64 位，文件偏移按 64 位计算，表空间不受 2^31 页的限制)
+typedef int64_t page_id_t;
+
+// 日志序列号: 日志记录在日志文件中的偏移，见 wal.h
+typedef uint64_t lsn_t;
+#define INVALID_LSN 0
 
 // 页面对象结构体
 // 这是在缓冲池中管理的单位
 typedef struct Page {
-    char data[PAGE_SIZE];       // 存储页面数据的数组
+    char* data;                 // 页面数据 (一个页面大小)，通常指向帧自己的缓冲区
     page_id_t page_id;          // 该页面在磁盘文件中的ID
     int pin_count;              // 被“钉住”的次数，只要 > 0 就不能被淘汰
     bool is_dirty;              // 页面内容是否被修改过
+    bool io_pending;            // 正在从磁盘读入 (或写回帧中的旧页)，其他线程需等待完成
+    bool mapped;                // data 指向数据文件的只读映射 (fetch_page_read_only 返回的零拷贝视图)
+    lsn_t page_lsn;             // 最后一条修改该页面的日志记录，写回前日志必须先刷到这里
+    lsn_t rec_lsn;              // 页面变脏后的第一条日志记录，检查点据此决定恢复从哪里开始重做
 } Page;
 
+// 脏页表的一项: 页面和它最早的未落盘修改
+typedef struct DirtyPageEntry {
+    page_id_t page_id;
+    lsn_t rec_lsn;
+} DirtyPageEntry;
+
+// 页表槽位: page_id 为 INVALID_PAGE_ID 表示空槽
+typedef struct PageTableEntry {
+    page_id_t page_id;
+    int frame_id;
+} PageTableEntry;
+
+// 表空间的页面布局
+typedef enum TablespaceLayout {
+    TABLESPACE_SEGMENTED,       // 分段: 第 i 个文件存放页号 [i * file_pages, (i + 1) * file_pages)
+    TABLESPACE_STRIPED          // 条带: 每 stripe_pages 页为一条，依次轮流放到各个文件
+} TablespaceLayout;
+
+// 表空间配置: 页面分布在多个数据文件中，每个文件可以放在不同的设备上
+typedef struct TablespaceConfig {
+    const char* files[MAX_TABLESPACE_FILES];
+    int num_files;
+    TablespaceLayout layout;
+    page_id_t file_pages;       // 每个文件最多存放的页数，0 表示不限 (只适用于单文件或条带布局)
+    page_id_t stripe_pages;     // 条带布局中一条的页数
+    bool direct_io;             // 用 O_DIRECT 打开数据文件，绕过操作系统的页缓存
+    int page_size;              // 页面大小，记录在空闲空间映射中，重新打开时必须一致
+} TablespaceConfig;
+
+// 只读映射的访问模式提示 (madvise)
+typedef enum MmapAdvice {
+    MMAP_RANDOM,                // 随机访问: 关闭内核预读
+    MMAP_SEQUENTIAL             // 顺序扫描: 加大内核预读，读过的页面优先回收
+} MmapAdvice;
+
 // 磁盘管理器结构体
 typedef struct DiskManager {
-    int file_descriptor;        // 数据库文件的文件描述符
-    char* file_name;            // 数据库文件名
+    int file_descriptors[MAX_TABLESPACE_FILES]; // 表空间中各个数据文件的文件描述符
+    int num_files;
+    char* file_name;            // 第一个数据文件名，空闲空间映射文件名由它得到
+    TablespaceLayout layout;
+    page_id_t file_pages;
+    page_id_t stripe_pages;
+    page_id_t max_pages;        // 表空间的容量 (页)，文件大小不限时为 INT64_MAX
+    bool direct_io;             // 数据文件是用 O_DIRECT 打开的
+    int page_size;
+
+    // 页面分配: 文件按区 (EXTENT_PAGES 页) 预留空间，页号从内存中的游标分配；
+    // 被 delete_page 释放的页面记在空闲空间映射中，优先重新分配。由 alloc_lock 保护
+    pthread_mutex_t alloc_lock;
+    page_id_t next_page_id;     // 下一个从文件末尾分配的页号
+    page_id_t extent_end;       // 已经预留空间的页数，游标到这里时再预留一个区
+    bool fallocate_supported;
+
+    // 空闲空间映射 (FSM): 每页一位，1 表示空闲。持久化在 <数据库文件名>.fsm，
+    // 文件头之后就是位图，每次修改都直接写回对应的字节
+    int fsm_file_descriptor;
+    uint8_t* fsm_bits;
+    size_t fsm_bytes;           // 位图的容量 (字节)
+    int64_t free_pages;         // 空闲页面数
+    page_id_t fsm_hint;         // 下一次从这里开始找空闲页面
+
+    // 只读映射 (disk_manager_map): 每个数据文件映射一次，长度是映射时的文件大小，
+    // 之后新增的页面不在映射中，仍按普通方式读入
+    bool mapped;
+    char* maps[MAX_TABLESPACE_FILES];
+    size_t map_sizes[MAX_TABLESPACE_FILES];
 } DiskManager;
 
+// 页面替换策略，实现见 replacer.h
+typedef enum ReplacerType {
+    REPLACER_LRU,               // 按最近一次使用的时间淘汰
+    REPLACER_CLOCK,             // 时钟算法，LRU 的近似，访问只需置一个引用位
+    REPLACER_LRU_K,             // LRU-2: 按倒数第二次访问的时间淘汰，只被访问过一次的页面优先。
+                                // 每次淘汰扫描分片内所有帧 (O(n))，适合较小的分片
+    REPLACER_2Q                 // 2Q: 新页面先进 FIFO 队列，短期内再次被访问才进入主 LRU 队列
+} ReplacerType;
+
+struct Replacer;
+struct AsyncIO;
+struct WAL;
+
+// 缓冲池配置
+typedef struct BufferPoolConfig {
+    int pool_size;              // 帧数
+    int max_pool_size;          // resize_buffer_pool 能扩大到的帧数，0 表示等于 pool_size
+    int page_size;              // 0 表示使用磁盘管理器的页面大小，否则必须和它一致
+    int num_shards;             // 分片数，页面按 page_id 的哈希值分到各个分片
+    bool concurrent;            // 是否允许多线程共享 (每个分片加锁)
+    ReplacerType replacer;      // 页面替换策略
+    int readahead_pages;        // 顺序访问时的预读窗口，0 表示关闭 (不超过 pool_size / 4)
+    bool use_io_uring;          // 预读使用 io_uring 批量提交 (不可用时自动退化为 pread)
+    int flusher_interval_ms;    // 后台刷盘线程的唤醒间隔，0 表示不启动
+    int flusher_clean_target;   // 保持至少这么多干净的可用帧，0 表示取 pool_size / 8
+    struct WAL* wal;            // 预写日志，不为空时脏页写回前先把日志刷到 page_lsn
+    int checkpoint_interval_ms; // 配置了日志时由后台线程定期做检查点，0 表示不做
+    bool huge_pages;            // 帧缓冲区不小于 HUGE_PAGE_SIZE 时优先使用显式大页 (MAP_HUGETLB)
+} BufferPoolConfig;
+
+// 缓冲池分片: 管理一段连续的帧，拥有自己的页表、空闲列表、淘汰队列和锁。
+// 并发模式下不同分片的操作互不阻塞，磁盘 I/O 在锁外进行
+typedef struct BufferPoolShard {
+    int frame_begin;            // 本分片在用的帧为 [frame_begin, frame_begin + frame_count)
+    int frame_count;            // 调整缓冲池大小时改变，之后的帧留作扩大时使用
+    int frame_capacity;         // 本分片预留的帧数 (页表、空闲列表和替换器按它分配)
+
+    PageTableEntry* page_table; // 页表: 映射 page_id -> frame_id (在缓冲池中的索引)，线性探测哈希表
+    int page_table_mask;        // 槽位数 - 1
+    int* free_list;             // 空闲帧列表
+    int free_list_size;
+
+    struct Replacer* replacer;  // 在本分片可淘汰的帧中选择淘汰对象
+
+    pthread_mutex_t latch;      // 保护本分片的元数据 (并发模式)
+    pthread_cond_t io_done;     // 帧的 io_pending 清除，或 retiring_frame 的 pin_count 降为 0 时广播
+    int retiring_frame;         // 缩小时正在等待被 unpin 的帧，没有时为 -1
+} BufferPoolShard;
+
 // 缓冲池管理器结构体
 typedef struct BufferPoolManager {
-    Page* pages;                // 指向缓冲池页面数组的指针 (大小为 BUFFER_POOL_SIZE)
+    Page* pages;                // 指向缓冲池页面数组的指针 (大小为 frame_capacity)
+    char* frame_data;           // 各帧的缓冲区，第 i 帧是 [i * page_size, (i + 1) * page_size)，按大页对齐
+    size_t frame_data_size;     // frame_data 是 mmap 得到的映射时为映射长度，否则为 0
+    int pool_size;              // 在用的帧数
+    int frame_capacity;         // 预留的帧数 (各分片的 frame_capacity 之和)，帧的地址不会移动
+    int page_size;
+    pthread_mutex_t resize_lock; // 同一时刻只有一次 resize_buffer_pool
     DiskManager* disk_manager;  // 指向磁盘管理器的指针
-    
-    int* page_table;            // 页表: 映射 page_id -> frame_id (在缓冲池中的索引)
-    int* free_list;             // 空闲帧列表
-    int free_list_size;
 
-    // 用于LRU页面替换算法的数据
-    int* lru_replacer;          // 一个简单的队列，存储可被淘汰的 frame_id
-    int lru_head;
-    int lru_tail;
-    bool* lru_in_replacer;      // 标记一个frame是否在lru_replacer中
+    BufferPoolShard* shards;
+    int num_shards;
+
+    // 预读: 顺序访问检测的状态和空闲的 AsyncIO 由 prefetch_lock 保护，
+    // 取帧、写回被淘汰的脏页和批量读都在锁外进行
+    struct AsyncIO** prefetch_ios; // [0, prefetch_io_free) 是空闲的
+    int prefetch_io_count;
+    int prefetch_io_free;
+    pthread_mutex_t prefetch_lock;
+    int readahead_pages;
+    page_id_t readahead_last;   // 上一次未命中的页号
+    page_id_t readahead_next;   // 上一个预读窗口之后的第一页
+    int readahead_run;          // 连续顺序未命中的次数
+
+    // 后台刷盘线程: 按 page_id 排序并合并相邻脏页批量写回，让淘汰时不必等待写盘
+    pthread_t flusher_thread;
+    pthread_mutex_t flusher_lock;
+    pthread_cond_t flusher_wake;
+    bool flusher_running;
+    bool flusher_started;
+    int flusher_interval_ms;
+    int flusher_clean_target;
+    int checkpoint_interval_ms;
 
+    struct WAL* wal;            // 为空时不做日志先行检查
+    // 每帧一项: 正在写回磁盘的页面和它的 rec_lsn (写回开始时已从 Page 中清掉)，
+    // 写回完成前检查点仍把它算作脏页。page_id 为 INVALID_PAGE_ID 表示没有。由分片锁保护
+    DirtyPageEntry* writebacks;
+
+    bool concurrent;            // 并发模式下访问分片元数据前加锁
+    bool verbose;               // 是否打印缓冲池调试日志 (默认打开)
 } BufferPoolManager;
 
+// 缓冲区访问策略: 大范围顺序读写时使用一小圈私有的帧循环复用，
+// 未命中时优先复用环中自己上次用过的帧，而不是从共享缓冲池中淘汰热点页面
+typedef enum AccessStrategyType {
+    ACCESS_BULK_READ,           // 大表顺序扫描
+    ACCESS_BULK_WRITE           // 批量写入 (环更大，给脏页写回留出余地)
+} AccessStrategyType;
+
+#define BULK_READ_RING_SIZE 32
+#define BULK_WRITE_RING_SIZE 256
+
+typedef struct BufferAccessStrategy {
+    AccessStrategyType type;
+    int ring_per_shard;         // 每个分片中环的长度
+    int* ring_frames;           // [shard * ring_per_shard + i]，-1 表示空位
+    page_id_t* ring_pages;      // 放入该帧时的页号，帧被其他线程挪用后两者不再一致
+    int* ring_next;             // 每个分片下一个要复用的位置
+} BufferAccessStrategy;
+
 
 // --- 函数声明 ---
 
 // 磁盘管理器函数
-DiskManager* create_disk_manager(const char* db_file);
+DiskManager* create_disk_manager(const char* db_file); // 单个数据文件的表空间
+void init_tablespace_config(TablespaceConfig* config); // 填入默认值: 分段布局，条带为 EXTENT_PAGES 页
+DiskManager* create_disk_manager_ex(const TablespaceConfig* config);
 void destroy_disk_manager(DiskManager* disk_manager);
+void sync_disk_manager(DiskManager* disk_manager); // 把所有数据文件刷到磁盘
+int disk_manager_locate(DiskManager* disk_manager, page_id_t page_id, off_t* offset); // 返回文件描述符
+// 把数据文件只读地映射进内存，之后 fetch_page_read_only 可以直接返回映射中的页面
+bool disk_manager_map(DiskManager* disk_manager, MmapAdvice advice);
+// 页面在映射中的地址，没有映射或页面在映射之外时返回 NULL
+const char* disk_manager_view(DiskManager* disk_manager, page_id_t page_id);
 void read_page_from_disk(DiskManager* disk_manager, page_id_t page_id, char* page_data);
 void write_page_to_disk(DiskManager* disk_manager, page_id_t page_id, const char* page_data);
+void write_pages_to_disk(DiskManager* disk_manager, page_id_t first_page_id, char* const* pages, int count);
 page_id_t allocate_page_on_disk(DiskManager* disk_manager);
+// 把页面标记为空闲，之后可以被重新分配。页面已经是空闲的时返回 false
+bool deallocate_page_on_disk(DiskManager* disk_manager, page_id_t page_id);
 
 // 缓冲池管理器函数
+void init_buffer_pool_config(BufferPoolConfig* config); // 填入默认值: BUFFER_POOL_SIZE 帧、单分片、非并发、LRU
 BufferPoolManager* create_buffer_pool_manager(DiskManager* disk_manager);
+BufferPoolManager* create_buffer_pool_manager_ex(DiskManager* disk_manager, const BufferPoolConfig* config);
 void destroy_buffer_pool_manager(BufferPoolManager* bpm);
+// 在线调整缓冲池的帧数 (不超过 max_pool_size)。缩小时被移出的帧中的页面尽量迁移到留下的空闲帧，
+// 没有空闲帧时淘汰 (脏页先写回)；被钉住的页面要等它被 unpin，所以调用者不能持有被钉住的页面。
+// 非并发模式下遇到被钉住的页面时放弃缩小并返回 false
+bool resize_buffer_pool(BufferPoolManager* bpm, int new_pool_size);
 Page* fetch_page(BufferPoolManager* bpm, page_id_t page_id);
+// 只读访问: 磁盘管理器映射了数据文件时不复制页面，page->data 直接指向映射 (只读)，
+// unpin 时 is_dirty 必须为 false。同一页面再被 fetch_page 时复制到帧中，之后可以修改
+Page* fetch_page_read_only(BufferPoolManager* bpm, page_id_t page_id);
 bool unpin_page(BufferPoolManager* bpm, page_id_t page_id, bool is_dirty);
 Page* new_page(BufferPoolManager* bpm, page_id_t* new_page_id);
+// 释放页面: 从缓冲池中移除 (不写回) 并在空闲空间映射中标记为空闲。页面被钉住时返回 false
+bool delete_page(BufferPoolManager* bpm, page_id_t page_id);
+// 预读提示: 把不在缓冲池中的页面批量读入空闲或可淘汰的帧，不钉住，返回读入的页面数
+int prefetch_pages(BufferPoolManager* bpm, const page_id_t* page_ids, int n);
+// 写回页面。写的是在分片锁下复制的快照，日志先刷到快照的 page_lsn。
+// 并发模式下被钉住的页面可能正在被修改，不写: flush_page 返回 false，flush_all_pages 跳过它们
 bool flush_page(BufferPoolManager* bpm, page_id_t page_id);
 void flush_all_pages(BufferPoolManager* bpm);
 
+// 把 rec_lsn 早于 lsn 的脏页写回磁盘 (检查点用来推进恢复的起点)，返回写出的页数
+int flush_pages_older_than(BufferPoolManager* bpm, lsn_t lsn);
+
+// 复制当前的脏页表 (包括正在写回的页面)，返回条数，*entries 由调用者 free。
+// 只收集 rec_lsn 有效的页面；每个分片只在复制时短暂加锁
+int collect_dirty_pages(BufferPoolManager* bpm, DirtyPageEntry** entries);
+
+// 访问策略: 一个策略对象只能由一个线程使用
+BufferAccessStrategy* create_access_strategy(BufferPoolManager* bpm, AccessStrategyType type);
+void destroy_access_strategy(BufferAccessStrategy* strategy);
+// 未命中时不触发预读，扫描只占用策略环中的帧
+Page* fetch_page_with_strategy(BufferPoolManager* bpm, page_id_t page_id, BufferAccessStrategy* strategy);
+
 #endif // DB_STORAGE_H
 
@@ -1,9 +1,156 @@
+#include <sys/wait.h>
 #include "db_storage.h"
+#include "wal.h"
+#include "recovery.h"
+
+#define RECOVERY_DB_FILE "recovery_demo.db"
+#define RECOVERY_LOG_FILE "recovery_demo.log"
+#define RECOVERY_PAGES 4
+#define SECOND_PART 64              // 页面中第二段数据的偏移
+
+// 打开崩溃恢复演示用的数据库和日志，关闭缓冲池的调试日志
+static BufferPoolManager* open_recovery_db(DiskManager** dm, WAL** wal) {
+    *dm = create_disk_manager(RECOVERY_DB_FILE);
+    *wal = create_wal(RECOVERY_LOG_FILE);
+    BufferPoolConfig config;
+    init_buffer_pool_config(&config);
+    config.wal = *wal;
+    BufferPoolManager* bpm = create_buffer_pool_manager_ex(*dm, &config);
+    bpm->verbose = false;
+    return bpm;
+}
+
+static void update_text(BufferPoolManager* bpm, WAL* wal, Transaction* txn,
+                        page_id_t page_id, uint32_t offset, const char* text) {
+    Page* page = fetch_page(bpm, page_id);
+    wal_update_page(wal, txn, page, offset, text, (uint32_t)strlen(text) + 1);
+    unpin_page(bpm, page_id, true);
+}
+
+// 在子进程中运行，最后不做任何清理直接退出 (崩溃)。
+// 返回截断日志的位置: T4 回滚时写的第二条补偿记录只落盘了一半
+static lsn_t run_until_crash(void) {
+    DiskManager* dm;
+    WAL* wal;
+    BufferPoolManager* bpm = open_recovery_db(&dm, &wal);
+
+    for (int i = 0; i < RECOVERY_PAGES; i++) {
+        page_id_t page_id;
+        Page* page = new_page(bpm, &page_id);
+        sprintf(page->data, "页面 %d 的初始内容", i);
+        sprintf(page->data + SECOND_PART, "页面 %d 第二段的初始内容", i);
+        unpin_page(bpm, page_id, true);
+    }
+    flush_all_pages(bpm);
+
+    Transaction t1, t2, t3, t4;
+    wal_begin_txn(wal, &t1);
+    update_text(bpm, wal, &t1, 0, 0, "T1 提交的内容");
+    wal_commit_txn(wal, &t1);
+
+    take_checkpoint(bpm, wal);
+
+    wal_begin_txn(wal, &t2);
+    update_text(bpm, wal, &t2, 1, 0, "T2 提交的内容");
+    wal_commit_txn(wal, &t2);
+
+    // T3 没有提交，但它修改的页面已经写回了数据文件
+    wal_begin_txn(wal, &t3);
+    update_text(bpm, wal, &t3, 2, 0, "T3 未提交的内容");
+    flush_page(bpm, 2);
+
+    // T4 修改两处后回滚
+    wal_begin_txn(wal, &t4);
+    update_text(bpm, wal, &t4, 3, 0, "T4 第一处修改");
+    update_text(bpm, wal, &t4, 3, SECOND_PART, "T4 第二处修改");
+    abort_transaction(bpm, wal, &t4);
+    wal_flush_all(wal);
+
+    // ABORT 记录的 prev_lsn 是最后一条补偿记录
+    LogRecordHeader header;
+    wal_read_record(wal, t4.last_lsn, &header, NULL, 0);
+    return header.prev_lsn + sizeof(LogRecordHeader) / 2;
+}
+
+static bool check_text(BufferPoolManager* bpm, page_id_t page_id, uint32_t offset, const char* expected) {
+    Page* page = fetch_page(bpm, page_id);
+    bool ok = page != NULL && strcmp(page->data + offset, expected) == 0;
+    printf("  Page %lld +%u: \"%s\" %s\n", (long long)page_id, offset,
+           page ? page->data + offset : "(无法读取)", ok ? "正确" : "错误!");
+    if (page) unpin_page(bpm, page_id, false);
+    return ok;
+}
+
+// 恢复并检查页面内容: T1、T2 的提交保留，T3、T4 的修改全部撤销。
+// crash 为 true 时恢复后直接退出进程 (在子进程中调用)
+static bool recover_and_check(bool crash) {
+    DiskManager* dm;
+    WAL* wal;
+    BufferPoolManager* bpm = open_recovery_db(&dm, &wal);
+    RecoveryStats stats;
+    bool ok = recover_database(bpm, wal, 1, &stats);
+    printf("%s检查点开始分析，脏页 %d 个，重做 %d 条记录，回滚 %d 个事务 (撤销 %d 条记录)\n",
+           stats.checkpoint_lsn != INVALID_LSN ? "从" : "没有",
+           stats.dirty_pages, stats.redo_records, stats.loser_txns, stats.undo_records);
+    ok &= check_text(bpm, 0, 0, "T1 提交的内容");
+    ok &= check_text(bpm, 1, 0, "T2 提交的内容");
+    ok &= check_text(bpm, 2, 0, "页面 2 的初始内容");
+    ok &= check_text(bpm, 3, 0, "页面 3 的初始内容");
+    ok &= check_text(bpm, 3, SECOND_PART, "页面 3 第二段的初始内容");
+    if (crash) {
+        fflush(stdout);
+        _exit(ok ? 0 : 1);
+    }
+    destroy_buffer_pool_manager(bpm);
+    destroy_wal(wal);
+    destroy_disk_manager(dm);
+    return ok;
+}
+
+// 崩溃恢复: 子进程提交 T1、做检查点、提交 T2，T3 未提交，T4 回滚到一半时崩溃
+// (日志尾部有一条写了一半的补偿记录)；恢复后再次崩溃，第二次恢复的结果必须相同
+static bool recovery_demo(void) {
+    remove(RECOVERY_DB_FILE);
+    remove(RECOVERY_DB_FILE ".fsm");
+    remove(RECOVERY_LOG_FILE);
+    fflush(stdout);
+
+    int fds[2];
+    if (pipe(fds) != 0) return false;
+    pid_t pid = fork();
+    if (pid == 0) {
+        lsn_t cut = run_until_crash();
+        if (write(fds[1], &cut, sizeof(cut)) != (ssize_t)sizeof(cut)) _exit(1);
+        _exit(0);
+    }
+    lsn_t cut = INVALID_LSN;
+    bool ok = pid > 0 && read(fds[0], &cut, sizeof(cut)) == (ssize_t)sizeof(cut);
+    close(fds[0]);
+    close(fds[1]);
+    if (pid > 0) waitpid(pid, NULL, 0);
+    if (!ok || truncate(RECOVERY_LOG_FILE, (off_t)cut) != 0) return false;
+    printf("子进程在回滚 T4 时崩溃，日志截断在 LSN %llu (最后一条补偿记录只写了一半)。\n",
+           (unsigned long long)cut);
+
+    printf("第一次恢复 (恢复后立即崩溃):\n");
+    fflush(stdout);
+    pid = fork();
+    if (pid == 0) recover_and_check(true);
+    int status = 0;
+    if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        return false;
+    }
+
+    printf("第二次恢复:\n");
+    return recover_and_check(false);
+}
+
 
 int main() {
     const char* db_filename = "my_database.db";
     // 清理旧的数据库文件以便于重新测试
     remove(db_filename);
+    remove("my_database.db.fsm");
 
     printf("--- 数据库存储层模拟程序 ---\n\n");
 
@@ -39,7 +186,7 @@ int main() {
             printf("无法创建新页面，缓冲池已满且无法淘汰。\n");
             break;
         }
-        sprintf(p->data, "这是自动创建的页面 %d", page_id_temp);
+        sprintf(p->data, "这是自动创建的页面 %lld", (long long)page_id_temp);
         unpin_page(bpm, p->page_id, false);
     }
     printf("已填满缓冲池，最早未被使用的页面应该已被淘汰。\n\n");
@@ -87,7 +234,11 @@ int main() {
     printf("\n--- 阶段 5: 关闭数据库 ---\n");
     destroy_buffer_pool_manager(bpm);
     destroy_disk_manager(dm);
-    printf("所有脏页已刷新，资源已释放。程序结束。\n");
+    printf("所有脏页已刷新，资源已释放。\n");
+
+    printf("\n--- 阶段 6: 崩溃恢复 ---\n");
+    printf(recovery_demo() ? "崩溃恢复测试通过。\n" : "崩溃恢复测试失败！\n");
+    printf("程序结束。\n");
 
     return 0;
 }
@@ -0,0 +1,383 @@
+#include "recovery.h"
+
+// 检查点的 DPT / ATT 记录每条最多容纳的项数
+#define DPT_PER_RECORD ((int)(WAL_MAX_PAYLOAD / sizeof(DirtyPageEntry)))
+#define ATT_PER_RECORD ((int)(WAL_MAX_PAYLOAD / sizeof(ActiveTxnEntry)))
+
+static pthread_mutex_t checkpoint_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+// --- 分析阶段用的哈希表: 键是 page_id 或 txn_id，值是 LSN ---
+
+typedef struct LsnMap {
+    int64_t* keys;
+    lsn_t* values;
+    uint8_t* states;            // 0 空，1 占用，2 已删除
+    size_t capacity;            // 2 的幂
+    size_t used;                // 占用和已删除的槽位数
+    size_t count;
+} LsnMap;
+
+static void lsn_map_init(LsnMap* map, size_t capacity) {
+    map->capacity = capacity;
+    map->keys = (int64_t*)malloc(capacity * sizeof(int64_t));
+    map->values = (lsn_t*)malloc(capacity * sizeof(lsn_t));
+    map->states = (uint8_t*)calloc(capacity, 1);
+    map->used = 0;
+    map->count = 0;
+}
+
+static void lsn_map_destroy(LsnMap* map) {
+    free(map->keys);
+    free(map->values);
+    free(map->states);
+}
+
+static size_t lsn_map_slot(const LsnMap* map, int64_t key) {
+    uint64_t h = (uint64_t)key * 0x9E3779B97F4A7C15ull;
+    return (size_t)(h ^ (h >> 29)) & (map->capacity - 1);
+}
+
+// 返回 key 所在的槽位，不存在时返回 -1
+static long lsn_map_find(const LsnMap* map, int64_t key) {
+    for (size_t i = lsn_map_slot(map, key); map->states[i] != 0; i = (i + 1) & (map->capacity - 1)) {
+        if (map->states[i] == 1 && map->keys[i] == key) return (long)i;
+    }
+    return -1;
+}
+
+static void lsn_map_put(LsnMap* map, int64_t key, lsn_t value);
+
+static void lsn_map_grow(LsnMap* map) {
+    LsnMap old = *map;
+    lsn_map_init(map, old.count * 4 > old.capacity ? old.capacity * 2 : old.capacity);
+    for (size_t i = 0; i < old.capacity; i++) {
+        if (old.states[i] == 1) lsn_map_put(map, old.keys[i], old.values[i]);
+    }
+    lsn_map_destroy(&old);
+}
+
+static void lsn_map_put(LsnMap* map, int64_t key, lsn_t value) {
+    long found = lsn_map_find(map, key);
+    if (found != -1) {
+        map->values[found] = value;
+        return;
+    }
+    if ((map->used + 1) * 4 > map->capacity * 3) lsn_map_grow(map);
+    size_t i = lsn_map_slot(map, key);
+    while (map->states[i] == 1) i = (i + 1) & (map->capacity - 1);
+    if (map->states[i] == 0) map->used++;
+    map->keys[i] = key;
+    map->values[i] = value;
+    map->states[i] = 1;
+    map->count++;
+}
+
+static void lsn_map_remove(LsnMap* map, int64_t key) {
+    long found = lsn_map_find(map, key);
+    if (found != -1) {
+        map->states[found] = 2;
+        map->count--;
+    }
+}
+
+
+// 记录修改的范围必须在页面之内，负载的长度必须和记录类型相符 (UPDATE 是前像加后像)
+static bool record_fits_page(const BufferPoolManager* bpm, const LogRecordHeader* record) {
+    uint64_t payload_size = record->size - sizeof(LogRecordHeader);
+    uint64_t expected = record->type == LOG_UPDATE ? 2 * (uint64_t)record->length : record->length;
+    return (uint64_t)record->offset + record->length <= (uint64_t)bpm->page_size && payload_size == expected;
+}
+
+
+// --- 撤销 ---
+
+// 撤销一条记录: UPDATE 恢复前像并写一条补偿记录。返回这个事务接下来要撤销的记录
+static lsn_t undo_record(BufferPoolManager* bpm, WAL* wal, Transaction* txn,
+                         const LogRecordHeader* record, const char* payload) {
+    if (record->type == LOG_CLR) return record->undo_next_lsn;
+    if (record->type != LOG_UPDATE) return record->prev_lsn;
+    if (!record_fits_page(bpm, record)) {
+        fprintf(stderr, "恢复: 错误! 日志记录 %llu 超出页面范围，跳过撤销.\n", (unsigned long long)record->lsn);
+        return record->prev_lsn;
+    }
+
+    Page* page = fetch_page(bpm, record->page_id);
+    if (page == NULL) {
+        fprintf(stderr, "恢复: 错误! 无法读入 page %lld 进行撤销.\n", (long long)record->page_id);
+        return record->prev_lsn;
+    }
+    LogRecordHeader clr;
+    memset(&clr, 0, sizeof(clr));
+    clr.type = LOG_CLR;
+    clr.undo_next_lsn = record->prev_lsn;
+    clr.page_id = record->page_id;
+    clr.offset = record->offset;
+    clr.length = record->length;
+    lsn_t lsn = wal_append_txn(wal, txn, &clr, payload, record->length);
+
+    memcpy(page->data + record->offset, payload, record->length);
+    page_mark_logged(page, lsn);
+    unpin_page(bpm, record->page_id, true);
+    return record->prev_lsn;
+}
+
+void abort_transaction(BufferPoolManager* bpm, WAL* wal, Transaction* txn) {
+    // 撤销要从日志文件中读回记录
+    wal_flush(wal, txn->last_lsn);
+    LogRecordHeader record;
+    char* payload = (char*)malloc(WAL_MAX_PAYLOAD);
+    lsn_t lsn = txn->last_lsn;
+    while (lsn != INVALID_LSN) {
+        if (!wal_read_record(wal, lsn, &record, payload, WAL_MAX_PAYLOAD)) {
+            fprintf(stderr, "恢复: 错误! 无法读取日志记录 %llu.\n", (unsigned long long)lsn);
+            break;
+        }
+        lsn = undo_record(bpm, wal, txn, &record, payload);
+    }
+    free(payload);
+    wal_end_txn(wal, txn, LOG_ABORT);
+}
+
+
+// --- 检查点 ---
+
+// 把一个数组拆成多条记录追加，每条最多 per_record 项
+static void append_entries(WAL* wal, LogRecordType type, const void* entries, int count,
+                           size_t entry_size, int per_record) {
+    for (int i = 0; i < count; i += per_record) {
+        int n = count - i < per_record ? count - i : per_record;
+        LogRecordHeader header;
+        memset(&header, 0, sizeof(header));
+        header.type = type;
+        header.page_id = INVALID_PAGE_ID;
+        header.length = (uint32_t)n;
+        wal_append(wal, &header, (const char*)entries + i * entry_size, (uint32_t)(n * entry_size));
+    }
+}
+
+lsn_t take_checkpoint(BufferPoolManager* bpm, WAL* wal) {
+    pthread_mutex_lock(&checkpoint_lock);
+
+    // 上一次检查点之前就变脏、至今没写回的页面现在写回，让重做的起点跟着检查点前进
+    flush_pages_older_than(bpm, wal->checkpoint_lsn);
+
+    LogRecordHeader header;
+    memset(&header, 0, sizeof(header));
+    header.type = LOG_CHECKPOINT_BEGIN;
+    header.page_id = INVALID_PAGE_ID;
+    header.txn_id = __atomic_load_n(&wal->next_txn_id, __ATOMIC_RELAXED);
+    lsn_t begin_lsn = wal_append(wal, &header, NULL, 0);
+
+    DirtyPageEntry* dirty_pages;
+    int dirty_count = collect_dirty_pages(bpm, &dirty_pages);
+    append_entries(wal, LOG_CHECKPOINT_DPT, dirty_pages, dirty_count, sizeof(DirtyPageEntry), DPT_PER_RECORD);
+    free(dirty_pages);
+
+    ActiveTxnEntry* txns;
+    int txn_count = wal_active_txns(wal, &txns);
+    append_entries(wal, LOG_CHECKPOINT_ATT, txns, txn_count, sizeof(ActiveTxnEntry), ATT_PER_RECORD);
+    free(txns);
+
+    memset(&header, 0, sizeof(header));
+    header.type = LOG_CHECKPOINT_END;
+    header.page_id = INVALID_PAGE_ID;
+    header.undo_next_lsn = begin_lsn;
+    lsn_t end_lsn = wal_append(wal, &header, NULL, 0);
+    wal_flush(wal, end_lsn);
+    // 检查点前写回的页面落盘后才能把重做的起点推进到这个检查点
+    sync_disk_manager(bpm->disk_manager);
+    wal_set_checkpoint(wal, begin_lsn);
+
+    pthread_mutex_unlock(&checkpoint_lock);
+    return begin_lsn;
+}
+
+
+// --- 恢复 ---
+
+typedef struct RedoWorker {
+    BufferPoolManager* bpm;
+    WAL* wal;
+    const LsnMap* dirty_pages;
+    lsn_t redo_lsn;
+    int index;
+    int num_workers;
+    int redo_records;
+    pthread_t thread;
+} RedoWorker;
+
+// 每个线程顺序读一遍日志，只重放 page_id 归自己的记录，同一页面上的记录仍按 LSN 顺序重放
+static void* redo_main(void* arg) {
+    RedoWorker* worker = (RedoWorker*)arg;
+    WALReader reader;
+    wal_reader_init(&reader, worker->wal, worker->redo_lsn);
+    LogRecordHeader record;
+    const char* payload;
+    while (wal_reader_next(&reader, &record, &payload)) {
+        if (record.type != LOG_UPDATE && record.type != LOG_CLR) continue;
+        if ((int)((uint64_t)record.page_id % (uint64_t)worker->num_workers) != worker->index) continue;
+        // 页面不在脏页表中，或者这条修改早于页面变脏的时间，说明它已经在磁盘上了
+        long slot = lsn_map_find(worker->dirty_pages, record.page_id);
+        if (slot == -1 || record.lsn < worker->dirty_pages->values[slot]) continue;
+        if (!record_fits_page(worker->bpm, &record)) {
+            fprintf(stderr, "恢复: 错误! 日志记录 %llu 超出页面范围，跳过重做.\n", (unsigned long long)record.lsn);
+            continue;
+        }
+
+        Page* page = fetch_page(worker->bpm, record.page_id);
+        if (page == NULL) {
+            fprintf(stderr, "恢复: 错误! 无法读入 page %lld 进行重做.\n", (long long)record.page_id);
+            continue;
+        }
+        const char* after = record.type == LOG_UPDATE ? payload + record.length : payload;
+        memcpy(page->data + record.offset, after, record.length);
+        page_mark_logged(page, record.lsn);
+        unpin_page(worker->bpm, record.page_id, true);
+        worker->redo_records++;
+    }
+    wal_reader_destroy(&reader);
+    return NULL;
+}
+
+bool recover_database(BufferPoolManager* bpm, WAL* wal, int num_threads, RecoveryStats* stats) {
+    RecoveryStats local_stats;
+    if (stats == NULL) stats = &local_stats;
+    memset(stats, 0, sizeof(*stats));
+    stats->checkpoint_lsn = wal->checkpoint_lsn;
+
+    // 1. 分析: 从最近的检查点扫描到日志末尾，重建脏页表和活跃事务表
+    LsnMap dirty_pages, active_txns, ended_txns;
+    lsn_map_init(&dirty_pages, 1024);
+    lsn_map_init(&active_txns, 64);
+    lsn_map_init(&ended_txns, 64);
+    page_id_t max_page_id = INVALID_PAGE_ID;
+
+    WALReader reader;
+    wal_reader_init(&reader, wal, wal->checkpoint_lsn != INVALID_LSN ? wal->checkpoint_lsn : WAL_HEADER_SIZE);
+    LogRecordHeader record;
+    const char* payload;
+    while (wal_reader_next(&reader, &record, &payload)) {
+        switch (record.type) {
+        case LOG_BEGIN:
+            lsn_map_put(&active_txns, record.txn_id, record.lsn);
+            break;
+        case LOG_UPDATE:
+        case LOG_CLR:
+            lsn_map_put(&active_txns, record.txn_id, record.lsn);
+            if (lsn_map_find(&dirty_pages, record.page_id) == -1) {
+                lsn_map_put(&dirty_pages, record.page_id, record.lsn);
+            }
+            if (record.page_id > max_page_id) max_page_id = record.page_id;
+            break;
+        case LOG_COMMIT:
+        case LOG_ABORT:
+            lsn_map_remove(&active_txns, record.txn_id);
+            lsn_map_put(&ended_txns, record.txn_id, record.lsn);
+            break;
+        case LOG_CHECKPOINT_DPT: {
+            // 检查点复制的 rec_lsn 早于扫描到的修改，取较小的一个
+            const DirtyPageEntry* entries = (const DirtyPageEntry*)payload;
+            for (uint32_t i = 0; i < record.length; i++) {
+                long slot = lsn_map_find(&dirty_pages, entries[i].page_id);
+                if (slot == -1 || entries[i].rec_lsn < dirty_pages.values[slot]) {
+                    lsn_map_put(&dirty_pages, entries[i].page_id, entries[i].rec_lsn);
+                }
+                if (entries[i].page_id > max_page_id) max_page_id = entries[i].page_id;
+            }
+            break;
+        }
+        case LOG_CHECKPOINT_ATT: {
+            // 复制活跃事务表之后才结束的事务已经在前面扫描到了，不能再加回来
+            const ActiveTxnEntry* entries = (const ActiveTxnEntry*)payload;
+            for (uint32_t i = 0; i < record.length; i++) {
+                if (lsn_map_find(&ended_txns, entries[i].txn_id) != -1) continue;
+                long slot = lsn_map_find(&active_txns, entries[i].txn_id);
+                if (slot == -1 || entries[i].last_lsn > active_txns.values[slot]) {
+                    lsn_map_put(&active_txns, entries[i].txn_id, entries[i].last_lsn);
+                }
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    wal_reader_destroy(&reader);
+    lsn_map_destroy(&ended_txns);
+
+    // 日志中出现过的页面可能在崩溃前还没有写进数据文件，新分配的页号要跳过它们
+    if (max_page_id != INVALID_PAGE_ID && bpm->disk_manager->next_page_id <= max_page_id) {
+        bpm->disk_manager->next_page_id = max_page_id + 1;
+    }
+
+    // 2. 重做: 从脏页表中最小的 rec_lsn 开始重放所有修改 (包括失败事务的修改和补偿记录)
+    stats->dirty_pages = (int)dirty_pages.count;
+    stats->redo_lsn = INVALID_LSN;
+    for (size_t i = 0; i < dirty_pages.capacity; i++) {
+        if (dirty_pages.states[i] == 1 && (stats->redo_lsn == INVALID_LSN || dirty_pages.values[i] < stats->redo_lsn)) {
+            stats->redo_lsn = dirty_pages.values[i];
+        }
+    }
+    if (stats->redo_lsn != INVALID_LSN) {
+        int workers = bpm->concurrent && num_threads > 1 ? num_threads : 1;
+        RedoWorker* redo = (RedoWorker*)calloc(workers, sizeof(RedoWorker));
+        for (int i = 0; i < workers; i++) {
+            redo[i].bpm = bpm;
+            redo[i].wal = wal;
+            redo[i].dirty_pages = &dirty_pages;
+            redo[i].redo_lsn = stats->redo_lsn;
+            redo[i].index = i;
+            redo[i].num_workers = workers;
+        }
+        if (workers == 1) {
+            redo_main(&redo[0]);
+        } else {
+            for (int i = 0; i < workers; i++) pthread_create(&redo[i].thread, NULL, redo_main, &redo[i]);
+            for (int i = 0; i < workers; i++) pthread_join(redo[i].thread, NULL);
+        }
+        for (int i = 0; i < workers; i++) stats->redo_records += redo[i].redo_records;
+        free(redo);
+    }
+    lsn_map_destroy(&dirty_pages);
+
+    // 3. 撤销: 每次回滚所有失败事务中 LSN 最大的那条记录，直到它们都回到开头
+    int loser_count = (int)active_txns.count;
+    Transaction* losers = (Transaction*)calloc(loser_count > 0 ? loser_count : 1, sizeof(Transaction));
+    lsn_t* undo_next = (lsn_t*)calloc(loser_count > 0 ? loser_count : 1, sizeof(lsn_t));
+    int n = 0;
+    for (size_t i = 0; i < active_txns.capacity; i++) {
+        if (active_txns.states[i] != 1) continue;
+        wal_resume_txn(wal, &losers[n], (uint32_t)active_txns.keys[i], active_txns.values[i]);
+        undo_next[n] = active_txns.values[i];
+        n++;
+    }
+    lsn_map_destroy(&active_txns);
+    stats->loser_txns = loser_count;
+
+    char* buffer = (char*)malloc(WAL_MAX_PAYLOAD);
+    for (;;) {
+        int next = -1;
+        for (int i = 0; i < loser_count; i++) {
+            if (undo_next[i] != INVALID_LSN && (next == -1 || undo_next[i] > undo_next[next])) next = i;
+        }
+        if (next == -1) break;
+        if (!wal_read_record(wal, undo_next[next], &record, buffer, WAL_MAX_PAYLOAD)) {
+            fprintf(stderr, "恢复: 错误! 无法读取日志记录 %llu.\n", (unsigned long long)undo_next[next]);
+            undo_next[next] = INVALID_LSN;
+            continue;
+        }
+        if (record.type == LOG_UPDATE) stats->undo_records++;
+        undo_next[next] = undo_record(bpm, wal, &losers[next], &record, buffer);
+    }
+    free(buffer);
+    for (int i = 0; i < loser_count; i++) {
+        wal_end_txn(wal, &losers[i], LOG_ABORT);
+    }
+    free(undo_next);
+    free(losers);
+
+    wal_flush_all(wal);
+    take_checkpoint(bpm, wal);
+    return true;
+}
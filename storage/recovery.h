@@ -0,0 +1,37 @@
+#ifndef RECOVERY_H
+#define RECOVERY_H
+
+#include "db_storage.h"
+#include "wal.h"
+
+// 模糊检查点和崩溃恢复 (ARIES 风格: 分析、重做、撤销)。
+//
+// 检查点不阻塞 fetch_page: 先追加 CHECKPOINT_BEGIN，再逐个分片短暂加锁复制脏页表、
+// 复制活跃事务表，写成 CHECKPOINT_DPT / CHECKPOINT_ATT 记录和 CHECKPOINT_END，
+// 落盘后把 BEGIN 的 LSN 记进日志文件头。检查点还会写回 rec_lsn 早于上一次检查点的脏页，
+// 所以重做的起点最多落后两个检查点间隔，重启时间只取决于检查点间隔内的日志量。
+//
+// 恢复从最近的检查点开始: 分析阶段重建脏页表和活跃事务表，重做阶段按 page_id
+// 把记录分给多个线程并行重放后像，撤销阶段按 LSN 从大到小回滚未提交的事务并写补偿记录
+
+typedef struct RecoveryStats {
+    lsn_t checkpoint_lsn;       // 恢复所用的检查点，INVALID_LSN 表示从日志开头分析
+    lsn_t redo_lsn;             // 重做的起点
+    int dirty_pages;            // 分析得到的脏页数
+    int redo_records;           // 实际重放的记录数
+    int loser_txns;             // 被回滚的事务数
+    int undo_records;           // 撤销的记录数
+} RecoveryStats;
+
+// 做一次模糊检查点，返回它的 CHECKPOINT_BEGIN 的 LSN。多个线程同时调用时串行执行
+lsn_t take_checkpoint(BufferPoolManager* bpm, WAL* wal);
+
+// 启动时在任何事务开始之前调用，缓冲池必须已经配置了这个日志 (config.wal)。
+// 缓冲池是并发模式时重做使用 num_threads 个线程，否则只用调用者一个线程。
+// 恢复结束时做一次检查点。stats 可以为空
+bool recover_database(BufferPoolManager* bpm, WAL* wal, int num_threads, RecoveryStats* stats);
+
+// 回滚事务: 沿 prev_lsn 链逐条恢复前像并写补偿记录，最后写 ABORT 记录
+void abort_transaction(BufferPoolManager* bpm, WAL* wal, Transaction* txn);
+
+#endif // RECOVERY_H
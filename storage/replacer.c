@@ -0,0 +1,468 @@
+#include "replacer.h"
+
+// --- 帧链表 ---
+// 侵入式双向链表，prev/next 数组按分片内下标存放，一个帧同时只在一条链表中
+
+#define LIST_NONE -1
+
+typedef struct FrameList {
+    int head;
+    int tail;
+    int size;
+} FrameList;
+
+static void list_init(FrameList* list) {
+    list->head = LIST_NONE;
+    list->tail = LIST_NONE;
+    list->size = 0;
+}
+
+static void list_push_back(FrameList* list, int* prev, int* next, int frame) {
+    prev[frame] = list->tail;
+    next[frame] = LIST_NONE;
+    if (list->tail != LIST_NONE) {
+        next[list->tail] = frame;
+    } else {
+        list->head = frame;
+    }
+    list->tail = frame;
+    list->size++;
+}
+
+static void list_remove(FrameList* list, int* prev, int* next, int frame) {
+    if (prev[frame] != LIST_NONE) {
+        next[prev[frame]] = next[frame];
+    } else {
+        list->head = next[frame];
+    }
+    if (next[frame] != LIST_NONE) {
+        prev[next[frame]] = prev[frame];
+    } else {
+        list->tail = prev[frame];
+    }
+    list->size--;
+}
+
+// 从表头 (最久未使用的一端) 找第一个可淘汰的帧
+static int list_find_evictable(const FrameList* list, const int* next, const bool* evictable) {
+    for (int frame = list->head; frame != LIST_NONE; frame = next[frame]) {
+        if (evictable[frame]) return frame;
+    }
+    return LIST_NONE;
+}
+
+static void init_base(Replacer* replacer, const ReplacerOps* ops, ReplacerType type,
+                      int frame_begin, int frame_count) {
+    replacer->ops = ops;
+    replacer->type = type;
+    replacer->frame_begin = frame_begin;
+    replacer->frame_count = frame_count;
+    replacer->evictable = (bool*)calloc(frame_count, sizeof(bool));
+    replacer->num_evictable = 0;
+}
+
+
+// --- LRU ---
+// 链表中只放可淘汰的帧，按 pin_count 降为 0 (最后一次使用结束) 的先后排列，三个操作都是 O(1)
+
+typedef struct LRUReplacer {
+    Replacer base;
+    FrameList list;
+    int* prev;
+    int* next;
+} LRUReplacer;
+
+static void lru_record_access(Replacer* replacer, int frame, page_id_t page_id) {
+    (void)replacer; (void)frame; (void)page_id; // 被访问的页面一定被钉住，不在链表中
+}
+
+static void lru_set_evictable(Replacer* replacer, int frame, bool evictable) {
+    LRUReplacer* lru = (LRUReplacer*)replacer;
+    if (evictable) {
+        list_push_back(&lru->list, lru->prev, lru->next, frame);
+    } else {
+        list_remove(&lru->list, lru->prev, lru->next, frame);
+    }
+}
+
+static bool lru_evict(Replacer* replacer, int* frame) {
+    LRUReplacer* lru = (LRUReplacer*)replacer;
+    if (lru->list.head == LIST_NONE) return false;
+    *frame = lru->list.head;
+    list_remove(&lru->list, lru->prev, lru->next, *frame);
+    return true;
+}
+
+static void lru_remove(Replacer* replacer, int frame, bool was_evictable) {
+    LRUReplacer* lru = (LRUReplacer*)replacer;
+    if (was_evictable) {
+        list_remove(&lru->list, lru->prev, lru->next, frame);
+    }
+}
+
+static void lru_destroy(Replacer* replacer) {
+    LRUReplacer* lru = (LRUReplacer*)replacer;
+    free(lru->prev);
+    free(lru->next);
+    free(replacer->evictable);
+    free(lru);
+}
+
+static const ReplacerOps lru_ops = { lru_record_access, lru_set_evictable, lru_evict, lru_remove, lru_destroy };
+
+static Replacer* create_lru_replacer(int frame_begin, int frame_count) {
+    LRUReplacer* lru = (LRUReplacer*)malloc(sizeof(LRUReplacer));
+    init_base(&lru->base, &lru_ops, REPLACER_LRU, frame_begin, frame_count);
+    list_init(&lru->list);
+    lru->prev = (int*)malloc(frame_count * sizeof(int));
+    lru->next = (int*)malloc(frame_count * sizeof(int));
+    return &lru->base;
+}
+
+
+// --- CLOCK ---
+// 每帧一个引用位，访问时置位；淘汰时指针转圈，遇到引用位为 1 的帧清零后跳过，
+// 遇到引用位为 0 的可淘汰帧就选中。访问路径上不需要移动任何链表
+
+typedef struct ClockReplacer {
+    Replacer base;
+    bool* referenced;
+    int hand;
+} ClockReplacer;
+
+static void clock_record_access(Replacer* replacer, int frame, page_id_t page_id) {
+    (void)page_id;
+    ((ClockReplacer*)replacer)->referenced[frame] = true;
+}
+
+static void clock_set_evictable(Replacer* replacer, int frame, bool evictable) {
+    (void)replacer; (void)frame; (void)evictable; // 可淘汰标记由 base 维护
+}
+
+static bool clock_evict(Replacer* replacer, int* frame) {
+    ClockReplacer* clock = (ClockReplacer*)replacer;
+    int n = replacer->frame_count;
+    // 最多转两圈: 第一圈清掉所有引用位后，第二圈一定能找到
+    for (int step = 0; step < 2 * n; step++) {
+        int candidate = clock->hand;
+        clock->hand = (clock->hand + 1) % n;
+        if (!replacer->evictable[candidate]) continue;
+        if (clock->referenced[candidate]) {
+            clock->referenced[candidate] = false;
+            continue;
+        }
+        *frame = candidate;
+        return true;
+    }
+    return false;
+}
+
+static void clock_remove(Replacer* replacer, int frame, bool was_evictable) {
+    (void)was_evictable;
+    ((ClockReplacer*)replacer)->referenced[frame] = false;
+}
+
+static void clock_destroy(Replacer* replacer) {
+    ClockReplacer* clock = (ClockReplacer*)replacer;
+    free(clock->referenced);
+    free(replacer->evictable);
+    free(clock);
+}
+
+static const ReplacerOps clock_ops = { clock_record_access, clock_set_evictable, clock_evict, clock_remove, clock_destroy };
+
+static Replacer* create_clock_replacer(int frame_begin, int frame_count) {
+    ClockReplacer* clock = (ClockReplacer*)malloc(sizeof(ClockReplacer));
+    init_base(&clock->base, &clock_ops, REPLACER_CLOCK, frame_begin, frame_count);
+    clock->referenced = (bool*)calloc(frame_count, sizeof(bool));
+    clock->hand = 0;
+    return &clock->base;
+}
+
+
+// --- LRU-K (K = 2) ---
+// 记录每帧最近两次访问的逻辑时间。只被访问过一次的帧 (倒数第二次访问距离为无穷大) 优先淘汰，
+// 其中取最早被访问的；否则淘汰倒数第二次访问最早的。一次性扫描的页面只有一次访问，
+// 不会挤掉反复被访问的热点页面。每次淘汰都扫描分片内所有帧，代价是 O(分片帧数)，
+// 分片很大时应该换成按倒数第二次访问时间排序的堆，或者改用 2Q / Clock
+
+typedef struct LRUKReplacer {
+    Replacer base;
+    uint64_t clock;             // 逻辑时钟，每次访问加一
+    uint64_t* last;             // 最近一次访问时间，0 表示没有
+    uint64_t* penultimate;      // 倒数第二次访问时间，0 表示没有
+} LRUKReplacer;
+
+static void lru_k_record_access(Replacer* replacer, int frame, page_id_t page_id) {
+    (void)page_id;
+    LRUKReplacer* lru_k = (LRUKReplacer*)replacer;
+    lru_k->penultimate[frame] = lru_k->last[frame];
+    lru_k->last[frame] = ++lru_k->clock;
+}
+
+static void lru_k_set_evictable(Replacer* replacer, int frame, bool evictable) {
+    (void)replacer; (void)frame; (void)evictable;
+}
+
+static bool lru_k_evict(Replacer* replacer, int* frame) {
+    LRUKReplacer* lru_k = (LRUKReplacer*)replacer;
+    int victim = LIST_NONE;
+    bool victim_has_k = true;
+    uint64_t victim_time = UINT64_MAX;
+    for (int i = 0; i < replacer->frame_count; i++) {
+        if (!replacer->evictable[i]) continue;
+        bool has_k = lru_k->penultimate[i] != 0;
+        uint64_t time = has_k ? lru_k->penultimate[i] : lru_k->last[i];
+        if ((victim_has_k && !has_k) || (has_k == victim_has_k && time < victim_time)) {
+            victim = i;
+            victim_has_k = has_k;
+            victim_time = time;
+        }
+    }
+    if (victim == LIST_NONE) return false;
+    lru_k->last[victim] = 0;
+    lru_k->penultimate[victim] = 0;
+    *frame = victim;
+    return true;
+}
+
+static void lru_k_remove(Replacer* replacer, int frame, bool was_evictable) {
+    (void)was_evictable;
+    LRUKReplacer* lru_k = (LRUKReplacer*)replacer;
+    lru_k->last[frame] = 0;
+    lru_k->penultimate[frame] = 0;
+}
+
+static void lru_k_destroy(Replacer* replacer) {
+    LRUKReplacer* lru_k = (LRUKReplacer*)replacer;
+    free(lru_k->last);
+    free(lru_k->penultimate);
+    free(replacer->evictable);
+    free(lru_k);
+}
+
+static const ReplacerOps lru_k_ops = { lru_k_record_access, lru_k_set_evictable, lru_k_evict, lru_k_remove, lru_k_destroy };
+
+static Replacer* create_lru_k_replacer(int frame_begin, int frame_count) {
+    LRUKReplacer* lru_k = (LRUKReplacer*)malloc(sizeof(LRUKReplacer));
+    init_base(&lru_k->base, &lru_k_ops, REPLACER_LRU_K, frame_begin, frame_count);
+    lru_k->clock = 0;
+    lru_k->last = (uint64_t*)calloc(frame_count, sizeof(uint64_t));
+    lru_k->penultimate = (uint64_t*)calloc(frame_count, sizeof(uint64_t));
+    return &lru_k->base;
+}
+
+
+// --- 2Q ---
+// 新读入的页面进入 A1in (FIFO)，在 A1in 中再次被访问不改变顺序。从 A1in 淘汰的页面
+// 把 page_id 记入 A1out (只记页号，不占帧)；A1out 中的页面再次被读入时说明它不只是被访问一次，
+// 直接进入主队列 Am (LRU)。A1in 超过 1/4 帧数时优先从 A1in 淘汰，否则从 Am 淘汰
+
+enum { TWO_Q_NONE, TWO_Q_A1IN, TWO_Q_AM };
+
+typedef struct GhostEntry {
+    page_id_t page_id;
+    int position;               // 在 ghost 环中的位置
+} GhostEntry;
+
+typedef struct TwoQReplacer {
+    Replacer base;
+    FrameList a1in;
+    FrameList am;
+    int* prev;
+    int* next;
+    uint8_t* queue;             // 帧所在的队列
+    page_id_t* page_ids;        // 帧中的页号，淘汰时记入 A1out
+    int a1in_target;            // A1in 的目标长度
+
+    page_id_t* ghost;           // A1out: 最近从 A1in 淘汰的页号，环形覆盖最老的
+    int ghost_capacity;
+    int ghost_next;
+    GhostEntry* ghost_index;    // A1out 的页号 -> 环中位置，每次未命中都要查，不能线性扫描
+    int ghost_index_mask;
+} TwoQReplacer;
+
+// --- A1out 索引 (线性探测哈希表，和页表相同的做法) ---
+
+static inline int ghost_slot(const TwoQReplacer* two_q, page_id_t page_id) {
+    uint64_t h = (uint64_t)page_id * 0x9E3779B97F4A7C15ull;
+    return (int)(h >> 32) & two_q->ghost_index_mask;
+}
+
+// 返回 page_id 在 ghost_index 中的槽位，不在时返回 -1
+static int ghost_index_find(const TwoQReplacer* two_q, page_id_t page_id) {
+    for (int i = ghost_slot(two_q, page_id); ; i = (i + 1) & two_q->ghost_index_mask) {
+        if (two_q->ghost_index[i].page_id == page_id) return i;
+        if (two_q->ghost_index[i].page_id == INVALID_PAGE_ID) return -1;
+    }
+}
+
+// 调用者保证 page_id 不在表中
+static void ghost_index_insert(TwoQReplacer* two_q, page_id_t page_id, int position) {
+    int i = ghost_slot(two_q, page_id);
+    while (two_q->ghost_index[i].page_id != INVALID_PAGE_ID) {
+        i = (i + 1) & two_q->ghost_index_mask;
+    }
+    two_q->ghost_index[i].page_id = page_id;
+    two_q->ghost_index[i].position = position;
+}
+
+// 删除槽位 hole 上的项，后面的项往前移，不留墓碑
+static void ghost_index_erase(TwoQReplacer* two_q, int hole) {
+    int mask = two_q->ghost_index_mask;
+    for (int i = (hole + 1) & mask; two_q->ghost_index[i].page_id != INVALID_PAGE_ID; i = (i + 1) & mask) {
+        int home = ghost_slot(two_q, two_q->ghost_index[i].page_id);
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            two_q->ghost_index[hole] = two_q->ghost_index[i];
+            hole = i;
+        }
+    }
+    two_q->ghost_index[hole].page_id = INVALID_PAGE_ID;
+}
+
+// 页号在 A1out 中时把它取出并返回 true
+static bool ghost_take(TwoQReplacer* two_q, page_id_t page_id) {
+    int slot = ghost_index_find(two_q, page_id);
+    if (slot == -1) return false;
+    two_q->ghost[two_q->ghost_index[slot].position] = INVALID_PAGE_ID;
+    ghost_index_erase(two_q, slot);
+    return true;
+}
+
+// 记入 A1out，环满时覆盖最老的一项
+static void ghost_put(TwoQReplacer* two_q, page_id_t page_id) {
+    int position = two_q->ghost_next;
+    page_id_t oldest = two_q->ghost[position];
+    if (oldest != INVALID_PAGE_ID) {
+        ghost_index_erase(two_q, ghost_index_find(two_q, oldest));
+    }
+    two_q->ghost[position] = page_id;
+    ghost_index_insert(two_q, page_id, position);
+    two_q->ghost_next = (position + 1) % two_q->ghost_capacity;
+}
+
+static void two_q_record_access(Replacer* replacer, int frame, page_id_t page_id) {
+    TwoQReplacer* two_q = (TwoQReplacer*)replacer;
+    switch (two_q->queue[frame]) {
+    case TWO_Q_AM:
+        list_remove(&two_q->am, two_q->prev, two_q->next, frame);
+        list_push_back(&two_q->am, two_q->prev, two_q->next, frame);
+        break;
+    case TWO_Q_A1IN:
+        break; // 短时间内的重复访问视为同一次
+    default:
+        two_q->page_ids[frame] = page_id;
+        if (ghost_take(two_q, page_id)) {
+            two_q->queue[frame] = TWO_Q_AM;
+            list_push_back(&two_q->am, two_q->prev, two_q->next, frame);
+        } else {
+            two_q->queue[frame] = TWO_Q_A1IN;
+            list_push_back(&two_q->a1in, two_q->prev, two_q->next, frame);
+        }
+        break;
+    }
+}
+
+static void two_q_set_evictable(Replacer* replacer, int frame, bool evictable) {
+    (void)replacer; (void)frame; (void)evictable;
+}
+
+static bool two_q_evict(Replacer* replacer, int* frame) {
+    TwoQReplacer* two_q = (TwoQReplacer*)replacer;
+    int victim = LIST_NONE;
+    if (two_q->a1in.size > two_q->a1in_target) {
+        victim = list_find_evictable(&two_q->a1in, two_q->next, replacer->evictable);
+    }
+    if (victim == LIST_NONE) {
+        victim = list_find_evictable(&two_q->am, two_q->next, replacer->evictable);
+    }
+    if (victim == LIST_NONE) {
+        victim = list_find_evictable(&two_q->a1in, two_q->next, replacer->evictable);
+    }
+    if (victim == LIST_NONE) return false;
+
+    if (two_q->queue[victim] == TWO_Q_A1IN) {
+        list_remove(&two_q->a1in, two_q->prev, two_q->next, victim);
+        ghost_put(two_q, two_q->page_ids[victim]);
+    } else {
+        list_remove(&two_q->am, two_q->prev, two_q->next, victim);
+    }
+    two_q->queue[victim] = TWO_Q_NONE;
+    *frame = victim;
+    return true;
+}
+
+// 直接移除不记入 A1out
+static void two_q_remove(Replacer* replacer, int frame, bool was_evictable) {
+    (void)was_evictable;
+    TwoQReplacer* two_q = (TwoQReplacer*)replacer;
+    if (two_q->queue[frame] == TWO_Q_A1IN) {
+        list_remove(&two_q->a1in, two_q->prev, two_q->next, frame);
+    } else if (two_q->queue[frame] == TWO_Q_AM) {
+        list_remove(&two_q->am, two_q->prev, two_q->next, frame);
+    }
+    two_q->queue[frame] = TWO_Q_NONE;
+}
+
+static void two_q_destroy(Replacer* replacer) {
+    TwoQReplacer* two_q = (TwoQReplacer*)replacer;
+    free(two_q->prev);
+    free(two_q->next);
+    free(two_q->queue);
+    free(two_q->page_ids);
+    free(two_q->ghost);
+    free(two_q->ghost_index);
+    free(replacer->evictable);
+    free(two_q);
+}
+
+static const ReplacerOps two_q_ops = { two_q_record_access, two_q_set_evictable, two_q_evict, two_q_remove, two_q_destroy };
+
+static Replacer* create_two_q_replacer(int frame_begin, int frame_count) {
+    TwoQReplacer* two_q = (TwoQReplacer*)malloc(sizeof(TwoQReplacer));
+    init_base(&two_q->base, &two_q_ops, REPLACER_2Q, frame_begin, frame_count);
+    list_init(&two_q->a1in);
+    list_init(&two_q->am);
+    two_q->prev = (int*)malloc(frame_count * sizeof(int));
+    two_q->next = (int*)malloc(frame_count * sizeof(int));
+    two_q->queue = (uint8_t*)calloc(frame_count, sizeof(uint8_t));
+    two_q->page_ids = (page_id_t*)malloc(frame_count * sizeof(page_id_t));
+    // 论文建议 Kin 取 25%、Kout 取 50% 的帧数
+    two_q->a1in_target = frame_count / 4 > 0 ? frame_count / 4 : 1;
+    two_q->ghost_capacity = frame_count / 2 > 0 ? frame_count / 2 : 1;
+    two_q->ghost = (page_id_t*)malloc(two_q->ghost_capacity * sizeof(page_id_t));
+    for (int i = 0; i < two_q->ghost_capacity; i++) {
+        two_q->ghost[i] = INVALID_PAGE_ID;
+    }
+    two_q->ghost_next = 0;
+    // 槽位数取不小于两倍容量的 2 的幂，装载率不超过一半
+    int slots = 1;
+    while (slots < two_q->ghost_capacity * 2) slots <<= 1;
+    two_q->ghost_index = (GhostEntry*)malloc(slots * sizeof(GhostEntry));
+    for (int i = 0; i < slots; i++) {
+        two_q->ghost_index[i].page_id = INVALID_PAGE_ID;
+    }
+    two_q->ghost_index_mask = slots - 1;
+    return &two_q->base;
+}
+
+
+// --- 工厂 ---
+
+Replacer* create_replacer(ReplacerType type, int frame_begin, int frame_count) {
+    switch (type) {
+    case REPLACER_CLOCK: return create_clock_replacer(frame_begin, frame_count);
+    case REPLACER_LRU_K: return create_lru_k_replacer(frame_begin, frame_count);
+    case REPLACER_2Q:    return create_two_q_replacer(frame_begin, frame_count);
+    default:             return create_lru_replacer(frame_begin, frame_count);
+    }
+}
+
+const char* replacer_name(ReplacerType type) {
+    switch (type) {
+    case REPLACER_CLOCK: return "CLOCK";
+    case REPLACER_LRU_K: return "LRU-2";
+    case REPLACER_2Q:    return "2Q";
+    default:             return "LRU";
+    }
+}
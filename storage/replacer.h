@@ -0,0 +1,73 @@
+#ifndef REPLACER_H
+#define REPLACER_H
+
+#include "db_storage.h"
+
+// 页面替换策略接口。每个缓冲池分片持有一个替换器，负责该分片的一段帧
+// [frame_begin, frame_begin + frame_count)，调用者负责加锁。
+// 缓冲池在以下时机通知替换器:
+// - 页面被访问 (命中或刚从磁盘读入): replacer_record_access
+// - pin_count 在 0 和非 0 之间变化: replacer_set_evictable
+// - 需要空闲帧: replacer_evict，在可淘汰的帧中选一个并清除它的访问历史
+// - 帧不经过淘汰被直接复用或释放: replacer_remove，清除它的访问历史
+
+typedef struct Replacer Replacer;
+
+typedef struct ReplacerOps {
+    void (*record_access)(Replacer* replacer, int frame, page_id_t page_id);
+    void (*set_evictable)(Replacer* replacer, int frame, bool evictable);
+    bool (*evict)(Replacer* replacer, int* frame);
+    void (*remove)(Replacer* replacer, int frame, bool was_evictable);
+    void (*destroy)(Replacer* replacer);
+} ReplacerOps;
+
+// 各策略的结构体以 Replacer 作为第一个成员。frame 参数是分片内的下标 (frame_id - frame_begin)
+struct Replacer {
+    const ReplacerOps* ops;
+    ReplacerType type;
+    int frame_begin;
+    int frame_count;
+    bool* evictable;            // 按分片内下标
+    int num_evictable;
+};
+
+Replacer* create_replacer(ReplacerType type, int frame_begin, int frame_count);
+const char* replacer_name(ReplacerType type);
+
+static inline void replacer_record_access(Replacer* replacer, int frame_id, page_id_t page_id) {
+    replacer->ops->record_access(replacer, frame_id - replacer->frame_begin, page_id);
+}
+
+static inline void replacer_set_evictable(Replacer* replacer, int frame_id, bool evictable) {
+    int frame = frame_id - replacer->frame_begin;
+    if (replacer->evictable[frame] == evictable) return;
+    replacer->evictable[frame] = evictable;
+    replacer->num_evictable += evictable ? 1 : -1;
+    replacer->ops->set_evictable(replacer, frame, evictable);
+}
+
+// 选出一个可淘汰的帧，没有可淘汰的帧时返回 false
+static inline bool replacer_evict(Replacer* replacer, int* frame_id) {
+    int frame;
+    if (replacer->num_evictable == 0 || !replacer->ops->evict(replacer, &frame)) return false;
+    replacer->evictable[frame] = false;
+    replacer->num_evictable--;
+    *frame_id = replacer->frame_begin + frame;
+    return true;
+}
+
+static inline void replacer_remove(Replacer* replacer, int frame_id) {
+    int frame = frame_id - replacer->frame_begin;
+    bool was_evictable = replacer->evictable[frame];
+    if (was_evictable) {
+        replacer->evictable[frame] = false;
+        replacer->num_evictable--;
+    }
+    replacer->ops->remove(replacer, frame, was_evictable);
+}
+
+static inline void destroy_replacer(Replacer* replacer) {
+    if (replacer) replacer->ops->destroy(replacer);
+}
+
+#endif // REPLACER_H
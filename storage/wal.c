@@ -0,0 +1,415 @@
+#include "wal.h"
+
+static const char WAL_MAGIC[8] = { 'D', 'B', 'L', 'A', 'B', 'W', 'A', 'L' };
+
+// 文件头: 8 字节魔数，接着 8 字节最近一次检查点的 LSN
+#define WAL_CHECKPOINT_OFFSET 8
+#define WAL_READ_CHUNK (1 << 20)
+
+// FNV-1a
+static uint32_t checksum_update(uint32_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t record_checksum(const LogRecordHeader* header, const void* payload, uint32_t payload_size) {
+    LogRecordHeader copy = *header;
+    copy.checksum = 0;
+    uint32_t hash = checksum_update(2166136261u, &copy, sizeof(copy));
+    return checksum_update(hash, payload, payload_size);
+}
+
+static bool write_all(int fd, const char* data, size_t size, off_t offset) {
+    while (size > 0) {
+        ssize_t n = pwrite(fd, data, size, offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= (size_t)n;
+        offset += n;
+    }
+    return true;
+}
+
+static bool record_size_valid(const LogRecordHeader* header) {
+    return header->size >= sizeof(LogRecordHeader) && header->size - sizeof(LogRecordHeader) <= WAL_MAX_PAYLOAD;
+}
+
+// 从文件中读一条记录并校验，end 是文件中有效数据的末尾
+static bool read_record_from_file(int fd, lsn_t lsn, lsn_t end, LogRecordHeader* header,
+                                  char* payload, size_t payload_capacity) {
+    if (lsn < WAL_HEADER_SIZE || lsn + sizeof(LogRecordHeader) > end) return false;
+    if (pread(fd, header, sizeof(LogRecordHeader), (off_t)lsn) != (ssize_t)sizeof(LogRecordHeader)) {
+        return false;
+    }
+    if (!record_size_valid(header) || lsn + header->size > end || header->lsn != lsn) {
+        return false;
+    }
+    uint32_t payload_size = header->size - sizeof(LogRecordHeader);
+    if (payload_size > payload_capacity ||
+        pread(fd, payload, payload_size, (off_t)(lsn + sizeof(LogRecordHeader))) != (ssize_t)payload_size) {
+        return false;
+    }
+    return record_checksum(header, payload, payload_size) == header->checksum;
+}
+
+
+// --- 打开和关闭 ---
+
+WAL* create_wal(const char* log_file) {
+    int fd = open(log_file, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+    if (fd == -1) {
+        perror("无法打开或创建日志文件");
+        return NULL;
+    }
+
+    char header[WAL_HEADER_SIZE];
+    off_t file_size = lseek(fd, 0, SEEK_END);
+    if (file_size < WAL_HEADER_SIZE) {
+        memset(header, 0, sizeof(header));
+        memcpy(header, WAL_MAGIC, sizeof(WAL_MAGIC));
+        if (!write_all(fd, header, sizeof(header), 0) || fdatasync(fd) != 0) {
+            perror("无法写入日志文件头");
+            close(fd);
+            return NULL;
+        }
+        file_size = WAL_HEADER_SIZE;
+    } else if (pread(fd, header, sizeof(header), 0) != WAL_HEADER_SIZE ||
+               memcmp(header, WAL_MAGIC, sizeof(WAL_MAGIC)) != 0) {
+        fprintf(stderr, "日志: 错误! %s 不是日志文件.\n", log_file);
+        close(fd);
+        return NULL;
+    }
+
+    // 找到最后一条完整的记录，崩溃时写了一半的尾部截掉，新记录从这里接着写。
+    // 有检查点时从检查点开始扫描，打开日志的时间不随日志变长而增加
+    LogRecordHeader record;
+    char* payload = (char*)malloc(WAL_MAX_PAYLOAD);
+    lsn_t checkpoint_lsn;
+    memcpy(&checkpoint_lsn, header + WAL_CHECKPOINT_OFFSET, sizeof(checkpoint_lsn));
+    if (!read_record_from_file(fd, checkpoint_lsn, (lsn_t)file_size, &record, payload, WAL_MAX_PAYLOAD) ||
+        record.type != LOG_CHECKPOINT_BEGIN) {
+        checkpoint_lsn = INVALID_LSN;
+    }
+    lsn_t end = checkpoint_lsn != INVALID_LSN ? checkpoint_lsn : WAL_HEADER_SIZE;
+    uint32_t max_txn_id = 0;
+    while (read_record_from_file(fd, end, (lsn_t)file_size, &record, payload, WAL_MAX_PAYLOAD)) {
+        uint32_t txn_id = record.type == LOG_CHECKPOINT_BEGIN ? record.txn_id - 1 : record.txn_id;
+        if (txn_id > max_txn_id) max_txn_id = txn_id;
+        end += record.size;
+    }
+    free(payload);
+    if ((off_t)end < file_size && ftruncate(fd, (off_t)end) != 0) {
+        perror("无法截断日志文件");
+    }
+
+    WAL* wal = (WAL*)calloc(1, sizeof(WAL));
+    wal->file_descriptor = fd;
+    wal->file_name = strdup(log_file);
+    pthread_mutex_init(&wal->lock, NULL);
+    pthread_cond_init(&wal->flushed, NULL);
+    wal->buffers[0] = (char*)malloc(WAL_BUFFER_SIZE);
+    wal->buffers[1] = (char*)malloc(WAL_BUFFER_SIZE);
+    wal->active = 0;
+    wal->used = 0;
+    wal->buffer_lsn = end;
+    wal->durable_lsn = end;
+    wal->flushing = false;
+    wal->next_txn_id = max_txn_id + 1;
+    wal->group_commit_delay_us = 0;
+    wal->active_txns = NULL;
+    wal->checkpoint_lsn = checkpoint_lsn;
+    wal->page_size = MAX_PAGE_SIZE;
+    return wal;
+}
+
+void destroy_wal(WAL* wal) {
+    if (wal) {
+        wal_flush_all(wal);
+        close(wal->file_descriptor);
+        pthread_mutex_destroy(&wal->lock);
+        pthread_cond_destroy(&wal->flushed);
+        free(wal->buffers[0]);
+        free(wal->buffers[1]);
+        free(wal->file_name);
+        free(wal);
+    }
+}
+
+
+// --- 追加和刷盘 ---
+
+// 当前的 leader 写盘: 交换两块缓冲区，锁外把旧的活动缓冲区写入文件并 fsync。
+// 调用前持有锁且没有其他 leader，返回时仍持有锁
+static void flush_locked(WAL* wal) {
+    wal->flushing = true;
+    char* buffer = wal->buffers[wal->active];
+    size_t size = wal->used;
+    lsn_t start = wal->buffer_lsn;
+    wal->active ^= 1;
+    wal->used = 0;
+    wal->buffer_lsn = start + size;
+    pthread_mutex_unlock(&wal->lock);
+
+    if (!write_all(wal->file_descriptor, buffer, size, (off_t)start) || fdatasync(wal->file_descriptor) != 0) {
+        // 日志写不进去时继续运行会违反持久性保证
+        perror("日志: 写入日志文件失败");
+        abort();
+    }
+
+    pthread_mutex_lock(&wal->lock);
+    wal->durable_lsn = start + size;
+    wal->sync_count++;
+    wal->flushing = false;
+    pthread_cond_broadcast(&wal->flushed);
+}
+
+// 调用前持有锁，payload_size 已经检查过
+static lsn_t append_locked(WAL* wal, LogRecordHeader* header, const void* payload, uint32_t payload_size) {
+    header->size = (uint32_t)sizeof(LogRecordHeader) + payload_size;
+
+    // 活动缓冲区放不下时先把它写出去；已经有 leader 在写盘时等它完成后再交换
+    while (wal->used + header->size > WAL_BUFFER_SIZE) {
+        if (wal->flushing) {
+            pthread_cond_wait(&wal->flushed, &wal->lock);
+        } else {
+            flush_locked(wal);
+        }
+    }
+    header->lsn = wal->buffer_lsn + wal->used;
+    header->checksum = record_checksum(header, payload, payload_size);
+    char* dest = wal->buffers[wal->active] + wal->used;
+    memcpy(dest, header, sizeof(LogRecordHeader));
+    if (payload_size > 0) memcpy(dest + sizeof(LogRecordHeader), payload, payload_size);
+    wal->used += header->size;
+    return header->lsn;
+}
+
+static bool payload_size_valid(uint32_t payload_size) {
+    if (payload_size > WAL_MAX_PAYLOAD) {
+        fprintf(stderr, "日志: 错误! 记录过大 (%u 字节).\n", payload_size);
+        return false;
+    }
+    return true;
+}
+
+lsn_t wal_append(WAL* wal, LogRecordHeader* header, const void* payload, uint32_t payload_size) {
+    if (!payload_size_valid(payload_size)) return INVALID_LSN;
+    pthread_mutex_lock(&wal->lock);
+    lsn_t lsn = append_locked(wal, header, payload, payload_size);
+    pthread_mutex_unlock(&wal->lock);
+    return lsn;
+}
+
+lsn_t wal_append_txn(WAL* wal, Transaction* txn, LogRecordHeader* header, const void* payload, uint32_t payload_size) {
+    if (!payload_size_valid(payload_size)) return INVALID_LSN;
+    pthread_mutex_lock(&wal->lock);
+    header->txn_id = txn->txn_id;
+    header->prev_lsn = txn->last_lsn;
+    txn->last_lsn = append_locked(wal, header, payload, payload_size);
+    pthread_mutex_unlock(&wal->lock);
+    return header->lsn;
+}
+
+void wal_flush(WAL* wal, lsn_t lsn) {
+    if (lsn == INVALID_LSN) return;
+    pthread_mutex_lock(&wal->lock);
+    while (wal->durable_lsn <= lsn) {
+        if (wal->flushing) {
+            // 其他线程正在写盘，等它完成；如果没有覆盖到 lsn，下一轮由某个等待者接着写
+            pthread_cond_wait(&wal->flushed, &wal->lock);
+            continue;
+        }
+        if (wal->used == 0) break; // lsn 还没有被追加
+        if (wal->group_commit_delay_us > 0) {
+            // 稍等一下，让并发的提交者把记录追加进来，一起刷盘
+            wal->flushing = true;
+            pthread_mutex_unlock(&wal->lock);
+            usleep(wal->group_commit_delay_us);
+            pthread_mutex_lock(&wal->lock);
+            wal->flushing = false;
+        }
+        flush_locked(wal);
+    }
+    pthread_mutex_unlock(&wal->lock);
+}
+
+void wal_flush_all(WAL* wal) {
+    pthread_mutex_lock(&wal->lock);
+    lsn_t end = wal->buffer_lsn + wal->used;
+    pthread_mutex_unlock(&wal->lock);
+    if (end > WAL_HEADER_SIZE) wal_flush(wal, end - 1);
+}
+
+static lsn_t durable_lsn(WAL* wal) {
+    pthread_mutex_lock(&wal->lock);
+    lsn_t lsn = wal->durable_lsn;
+    pthread_mutex_unlock(&wal->lock);
+    return lsn;
+}
+
+bool wal_read_record(WAL* wal, lsn_t lsn, LogRecordHeader* header, char* payload, size_t payload_capacity) {
+    return read_record_from_file(wal->file_descriptor, lsn, durable_lsn(wal), header, payload, payload_capacity);
+}
+
+void wal_set_checkpoint(WAL* wal, lsn_t begin_lsn) {
+    if (!write_all(wal->file_descriptor, (const char*)&begin_lsn, sizeof(begin_lsn), WAL_CHECKPOINT_OFFSET) ||
+        fdatasync(wal->file_descriptor) != 0) {
+        perror("日志: 无法记录检查点位置");
+        return;
+    }
+    pthread_mutex_lock(&wal->lock);
+    wal->checkpoint_lsn = begin_lsn;
+    pthread_mutex_unlock(&wal->lock);
+}
+
+int wal_active_txns(WAL* wal, ActiveTxnEntry** entries) {
+    pthread_mutex_lock(&wal->lock);
+    int count = 0;
+    for (Transaction* txn = wal->active_txns; txn; txn = txn->next) count++;
+    *entries = (ActiveTxnEntry*)malloc((count > 0 ? count : 1) * sizeof(ActiveTxnEntry));
+    int i = 0;
+    for (Transaction* txn = wal->active_txns; txn; txn = txn->next, i++) {
+        (*entries)[i].txn_id = txn->txn_id;
+        (*entries)[i].reserved = 0;
+        (*entries)[i].last_lsn = txn->last_lsn;
+    }
+    pthread_mutex_unlock(&wal->lock);
+    return count;
+}
+
+
+// --- 顺序读日志 ---
+
+void wal_reader_init(WALReader* reader, WAL* wal, lsn_t start_lsn) {
+    reader->wal = wal;
+    reader->buffer = (char*)malloc(WAL_READ_CHUNK);
+    reader->buffer_len = 0;
+    reader->buffer_lsn = start_lsn;
+    reader->next_lsn = start_lsn;
+    reader->end_lsn = durable_lsn(wal);
+}
+
+// 让 [next_lsn, next_lsn + size) 都在缓冲区中，必要时从 next_lsn 开始重新读一块
+static bool reader_ensure(WALReader* reader, size_t size) {
+    if (reader->next_lsn + size > reader->end_lsn) return false;
+    if (reader->next_lsn >= reader->buffer_lsn &&
+        reader->next_lsn + size <= reader->buffer_lsn + reader->buffer_len) {
+        return true;
+    }
+    size_t want = reader->end_lsn - reader->next_lsn < WAL_READ_CHUNK ? reader->end_lsn - reader->next_lsn : WAL_READ_CHUNK;
+    size_t got = 0;
+    while (got < want) {
+        ssize_t n = pread(reader->wal->file_descriptor, reader->buffer + got, want - got, (off_t)(reader->next_lsn + got));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        got += (size_t)n;
+    }
+    reader->buffer_lsn = reader->next_lsn;
+    reader->buffer_len = got;
+    return size <= got;
+}
+
+bool wal_reader_next(WALReader* reader, LogRecordHeader* header, const char** payload) {
+    if (reader->next_lsn < WAL_HEADER_SIZE || !reader_ensure(reader, sizeof(LogRecordHeader))) return false;
+    memcpy(header, reader->buffer + (reader->next_lsn - reader->buffer_lsn), sizeof(LogRecordHeader));
+    if (!record_size_valid(header) || header->lsn != reader->next_lsn || !reader_ensure(reader, header->size)) {
+        return false;
+    }
+    const char* record = reader->buffer + (reader->next_lsn - reader->buffer_lsn);
+    uint32_t payload_size = header->size - sizeof(LogRecordHeader);
+    if (record_checksum(header, record + sizeof(LogRecordHeader), payload_size) != header->checksum) return false;
+    *payload = record + sizeof(LogRecordHeader);
+    reader->next_lsn += header->size;
+    return true;
+}
+
+void wal_reader_destroy(WALReader* reader) {
+    free(reader->buffer);
+    reader->buffer = NULL;
+}
+
+
+// --- 事务接口 ---
+
+static void link_txn_locked(WAL* wal, Transaction* txn) {
+    txn->prev = NULL;
+    txn->next = wal->active_txns;
+    if (wal->active_txns) wal->active_txns->prev = txn;
+    wal->active_txns = txn;
+}
+
+void wal_begin_txn(WAL* wal, Transaction* txn) {
+    LogRecordHeader header;
+    memset(&header, 0, sizeof(header));
+    header.type = LOG_BEGIN;
+    header.page_id = INVALID_PAGE_ID;
+
+    pthread_mutex_lock(&wal->lock);
+    txn->txn_id = wal->next_txn_id++;
+    txn->last_lsn = INVALID_LSN;
+    link_txn_locked(wal, txn);
+    header.txn_id = txn->txn_id;
+    txn->last_lsn = append_locked(wal, &header, NULL, 0);
+    pthread_mutex_unlock(&wal->lock);
+}
+
+lsn_t wal_update_page(WAL* wal, Transaction* txn, Page* page, uint32_t offset, const void* data, uint32_t length) {
+    if (offset > (uint32_t)wal->page_size || length > (uint32_t)wal->page_size - offset) {
+        fprintf(stderr, "日志: 错误! 修改超出页面范围 (offset %u, length %u).\n", offset, length);
+        return INVALID_LSN;
+    }
+    char* images = (char*)malloc(2 * (size_t)length);
+    memcpy(images, page->data + offset, length);
+    memcpy(images + length, data, length);
+
+    LogRecordHeader header;
+    memset(&header, 0, sizeof(header));
+    header.type = LOG_UPDATE;
+    header.page_id = page->page_id;
+    header.offset = offset;
+    header.length = length;
+    lsn_t lsn = wal_append_txn(wal, txn, &header, images, 2 * length);
+    free(images);
+
+    memcpy(page->data + offset, data, length);
+    page_mark_logged(page, lsn);
+    return lsn;
+}
+
+void wal_resume_txn(WAL* wal, Transaction* txn, uint32_t txn_id, lsn_t last_lsn) {
+    pthread_mutex_lock(&wal->lock);
+    txn->txn_id = txn_id;
+    txn->last_lsn = last_lsn;
+    link_txn_locked(wal, txn);
+    pthread_mutex_unlock(&wal->lock);
+}
+
+void wal_end_txn(WAL* wal, Transaction* txn, LogRecordType type) {
+    LogRecordHeader header;
+    memset(&header, 0, sizeof(header));
+    header.type = type;
+    header.page_id = INVALID_PAGE_ID;
+
+    pthread_mutex_lock(&wal->lock);
+    header.txn_id = txn->txn_id;
+    header.prev_lsn = txn->last_lsn;
+    txn->last_lsn = append_locked(wal, &header, NULL, 0);
+    if (txn->prev) txn->prev->next = txn->next;
+    else wal->active_txns = txn->next;
+    if (txn->next) txn->next->prev = txn->prev;
+    txn->prev = txn->next = NULL;
+    pthread_mutex_unlock(&wal->lock);
+}
+
+void wal_commit_txn(WAL* wal, Transaction* txn) {
+    wal_end_txn(wal, txn, LOG_COMMIT);
+    wal_flush(wal, txn->last_lsn);
+    __atomic_fetch_add(&wal->commit_count, 1, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,153 @@
+#ifndef WAL_H
+#define WAL_H
+
+#include "db_storage.h"
+
+// 预写日志 (WAL)。日志文件只追加，LSN 就是记录在日志文件中的起始偏移，
+// 文件开头是 WAL_HEADER_SIZE 字节的文件头 (魔数和最近一次检查点的 LSN)，
+// 所以有效的 LSN 总是大于 0 (INVALID_LSN)。
+//
+// 修改页面前先追加一条 UPDATE 记录 (前像 + 后像)，并把记录的 LSN 写进 page->page_lsn；
+// 缓冲池把脏页写回磁盘之前先调用 wal_flush 把日志刷到 page_lsn，保证日志先于数据落盘。
+//
+// 组提交: 日志先追加到内存中的缓冲区，提交时等待日志落盘。同一时刻只有一个线程
+// (leader) 在写日志文件和 fsync，其他提交者把记录追加进另一块缓冲区后等待；
+// leader 完成后，下一个 leader 用一次 fsync 把这期间攒下的所有提交一起刷盘
+
+#define WAL_HEADER_SIZE 16
+#define WAL_BUFFER_SIZE (1 << 20)   // 每块日志缓冲区的大小 (双缓冲)
+#define WAL_MAX_PAYLOAD (2 * MAX_PAGE_SIZE) // 一条记录的负载上限: 一个页面的前像加后像
+
+typedef enum LogRecordType {
+    LOG_BEGIN = 1,
+    LOG_UPDATE,                 // 负载是 length 字节的前像，后面跟 length 字节的后像
+    LOG_COMMIT,
+    LOG_ABORT,                  // 回滚完成，事务结束
+    LOG_CLR,                    // 补偿记录: 回滚时恢复的字节 (length 字节)，只重做不撤销
+    LOG_CHECKPOINT_BEGIN,       // txn_id 字段记录当时的 next_txn_id
+    LOG_CHECKPOINT_DPT,         // 检查点的脏页表，负载是 DirtyPageEntry 数组，可以有多条
+    LOG_CHECKPOINT_ATT,         // 检查点的活跃事务表，负载是 ActiveTxnEntry 数组，可以有多条
+    LOG_CHECKPOINT_END
+} LogRecordType;
+
+// 日志记录头，后面紧跟负载
+typedef struct LogRecordHeader {
+    uint32_t size;              // 整条记录的字节数 (含头部)
+    uint32_t type;              // LogRecordType
+    lsn_t lsn;
+    lsn_t prev_lsn;             // 同一事务的上一条记录，INVALID_LSN 表示没有
+    lsn_t undo_next_lsn;        // CLR: 回滚接下来要撤销的记录
+    page_id_t page_id;          // UPDATE 修改的页面
+    uint32_t txn_id;
+    uint32_t offset;            // 修改的页内偏移
+    uint32_t length;            // 修改的字节数
+    uint32_t checksum;          // 整条记录的校验和 (计算时本字段为 0)，用于识别写了一半的尾部
+} LogRecordHeader;              // 没有填充字节，校验和覆盖整个头部
+
+// 检查点中的活跃事务
+typedef struct ActiveTxnEntry {
+    uint32_t txn_id;
+    uint32_t reserved;
+    lsn_t last_lsn;
+} ActiveTxnEntry;
+
+// 事务在日志中的状态: 事务号和它写的最后一条记录 (构成 prev_lsn 链)。
+// 从开始到提交或回滚结束，事务挂在 WAL 的活跃事务链表上，供检查点记录
+typedef struct Transaction {
+    uint32_t txn_id;
+    lsn_t last_lsn;
+    struct Transaction* prev;
+    struct Transaction* next;
+} Transaction;
+
+typedef struct WAL {
+    int file_descriptor;
+    char* file_name;
+
+    pthread_mutex_t lock;
+    pthread_cond_t flushed;     // 一次日志刷盘完成
+    char* buffers[2];           // 一块接收新记录，另一块由 leader 写盘
+    int active;                 // 正在接收新记录的缓冲区
+    size_t used;                // 活动缓冲区中已用的字节数
+    lsn_t buffer_lsn;           // 活动缓冲区第一个字节对应的 LSN
+    lsn_t durable_lsn;          // 这个 LSN 之前的日志都已落盘
+    bool flushing;              // 有 leader 正在写盘
+    uint32_t next_txn_id;
+    int group_commit_delay_us;  // leader 写盘前等待更多提交者的时间，默认 0
+    Transaction* active_txns;   // 活跃事务链表，由 lock 保护
+    lsn_t checkpoint_lsn;       // 最近一次完整检查点的 CHECKPOINT_BEGIN，没有时为 INVALID_LSN
+    int page_size;              // 修改不能超出的页面大小，交给缓冲池 (config.wal) 时设为缓冲池的页面大小
+
+    // 统计
+    uint64_t commit_count;
+    uint64_t sync_count;
+} WAL;
+
+// 打开 (或创建) 日志文件。已有的日志从头扫描到最后一条完整的记录，之后写了一半的部分被截掉
+WAL* create_wal(const char* log_file);
+void destroy_wal(WAL* wal);
+
+// 追加一条记录，填好 header 的 size、lsn 和 checksum，返回它的 LSN。记录只在内存中
+lsn_t wal_append(WAL* wal, LogRecordHeader* header, const void* payload, uint32_t payload_size);
+
+// 追加一条属于 txn 的记录，同时填好 txn_id 和 prev_lsn 并推进 txn->last_lsn
+lsn_t wal_append_txn(WAL* wal, Transaction* txn, LogRecordHeader* header, const void* payload, uint32_t payload_size);
+
+// 保证 LSN 为 lsn 的记录 (以及之前的所有记录) 已经落盘
+void wal_flush(WAL* wal, lsn_t lsn);
+
+// 把已追加的所有记录刷盘
+void wal_flush_all(WAL* wal);
+
+// 读出 LSN 为 lsn 的记录 (只读已经写入日志文件的部分)，负载最多 payload_capacity 字节。
+// 返回 false 表示 lsn 处没有完整有效的记录
+bool wal_read_record(WAL* wal, lsn_t lsn, LogRecordHeader* header, char* payload, size_t payload_capacity);
+
+// 检查点的 CHECKPOINT_END 落盘后，把它的 CHECKPOINT_BEGIN 记进文件头
+void wal_set_checkpoint(WAL* wal, lsn_t begin_lsn);
+
+// 复制当前的活跃事务表，返回条数，*entries 由调用者 free
+int wal_active_txns(WAL* wal, ActiveTxnEntry** entries);
+
+// 顺序读日志: 按块读入文件，逐条返回记录，读到第一条不完整的记录或已落盘部分的末尾为止
+typedef struct WALReader {
+    WAL* wal;
+    char* buffer;
+    size_t buffer_len;          // buffer 中有效的字节数
+    lsn_t buffer_lsn;           // buffer 第一个字节对应的 LSN
+    lsn_t next_lsn;
+    lsn_t end_lsn;
+} WALReader;
+
+void wal_reader_init(WALReader* reader, WAL* wal, lsn_t start_lsn);
+// 返回的 payload 指向读取器内部的缓冲区，下一次调用前有效
+bool wal_reader_next(WALReader* reader, LogRecordHeader* header, const char** payload);
+void wal_reader_destroy(WALReader* reader);
+
+// 页面被 lsn 这条记录修改: 先更新 page_lsn，页面变脏后的第一条记录再记为 rec_lsn。
+// 刷盘开始时 rec_lsn 被原子地换成 INVALID_LSN，之后的修改会重新设置它
+static inline void page_mark_logged(Page* page, lsn_t lsn) {
+    __atomic_store_n(&page->page_lsn, lsn, __ATOMIC_SEQ_CST);
+    lsn_t expected = INVALID_LSN;
+    __atomic_compare_exchange_n(&page->rec_lsn, &expected, lsn, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+// --- 事务接口 ---
+
+void wal_begin_txn(WAL* wal, Transaction* txn);
+
+// 把 data 写到页面的 [offset, offset + length) (必须在 wal->page_size 之内，否则返回 INVALID_LSN)，先记录前像和后像，再修改页面并更新 page_lsn。
+// 调用者必须钉住页面，并在 unpin 时标记为脏页；同一页面上的修改由调用者保证互斥
+lsn_t wal_update_page(WAL* wal, Transaction* txn, Page* page, uint32_t offset, const void* data, uint32_t length);
+
+// 追加 COMMIT 记录并等待它落盘 (组提交)，返回后事务的修改是持久的
+void wal_commit_txn(WAL* wal, Transaction* txn);
+
+// 恢复时把日志中没有结束的事务重新挂到活跃事务表上 (不写日志)，之后由撤销阶段回滚
+void wal_resume_txn(WAL* wal, Transaction* txn, uint32_t txn_id, lsn_t last_lsn);
+
+// 追加 COMMIT 或 ABORT 记录并把事务从活跃事务表中摘下，不等待落盘。
+// 回滚见 recovery.h 的 abort_transaction
+void wal_end_txn(WAL* wal, Transaction* txn, LogRecordType type);
+
+#endif // WAL_H